@@ -0,0 +1,236 @@
+#!/usr/bin/perl
+#
+# Resolves link lines built from the static libraries installed on this
+# machine and checks the result against GNU ld.  For each link line it
+# reports wall time, the time and memory resolve reports with --stats, the
+# members pulled and passes for each archive, and how resolve's pulled
+# members, defined symbols and undefined references compare with ld's.
+#
+# Every T, D and C symbol resolve defines is traced with ld -y, and the
+# file ld takes it from must be the one resolve names.  Each symbol where
+# they differ, and each member resolve pulls that ld does not, counts as a
+# mismatch, and the script exits with 1 when there are any.  ld also
+# follows weak definitions and makes some symbols itself, which resolve
+# does not model, so members only ld pulls and the undefined references
+# are printed but not counted.
+#
+# Libraries that are not installed are skipped.  Names are compared on
+# their first 30 characters, which is all resolve keeps.
+
+use strict;
+use warnings;
+use Time::HiRes qw(time);
+
+my $resolve = "../resolve";
+my $query = "../symbolQuery";
+my $mismatches = 0;
+
+# main objects that pull in typical parts of the C and C++ libraries
+my %sources = (
+    "cmain.c" => <<'END',
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+static int compare(const void *a, const void *b)
+{
+    return strcmp(*(char **) a, *(char **) b);
+}
+
+int main(int argc, char *argv[])
+{
+    char *copy = strdup(argc > 1 ? argv[1] : "0");
+    double x = strtod(copy, NULL);
+    qsort(argv, argc, sizeof(char *), compare);
+    printf("%f %f %ld\n", sqrt(x), pow(x, 1.5), (long) time(NULL));
+    free(copy);
+    return 0;
+}
+END
+    "cxxmain.cc" => <<'END',
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> args(argv, argv + argc);
+    std::map<std::string, int> counts;
+    std::sort(args.begin(), args.end());
+    for (const std::string &a : args)
+        counts[a]++;
+    std::cout << counts.size() << std::endl;
+    return 0;
+}
+END
+);
+
+my $libc = library("libc.a");
+my $libm = library("libm.a");
+my $libstdcxx = library("libstdc++.a");
+
+for my $file (sort keys %sources)
+{
+    open(my $fh, ">", $file) or die "$file: $!";
+    print $fh $sources{$file};
+    close($fh);
+}
+
+my @lines;
+push @lines, ["cmain.o", @$libm, @$libc] if @$libc && @$libm;
+push @lines, ["cmain.o", @$libc] if @$libc;
+push @lines, ["cxxmain.o", @$libstdcxx, @$libm, @$libc]
+    if @$libstdcxx && @$libm && @$libc;
+
+if (!@lines)
+{
+    print "Skipped: no static libc.a found\n";
+    exit 0;
+}
+
+system("gcc -O2 -c cmain.c -o cmain.o") == 0 or die "gcc failed";
+if (grep { $_->[0] eq "cxxmain.o" } @lines)
+{
+    system("g++ -O2 -c cxxmain.cc -o cxxmain.o") == 0 or die "g++ failed";
+}
+
+for my $line (@lines)
+{
+    $mismatches += bench(@$line);
+}
+
+system "rm -f cmain.c cxxmain.cc cmain.o cxxmain.o bench.idx bench.map bench.trace";
+
+print "$mismatches mismatches with ld\n";
+exit($mismatches > 0 ? 1 : 0);
+
+# find a library with gcc, following linker scripts such as libm.a that
+# only name the real archives
+sub library
+{
+    my ($name) = @_;
+    my $path = `gcc -print-file-name=$name`;
+    chomp $path;
+    return [] if $path eq $name || !-f $path;
+
+    open(my $fh, "<", $path) or return [];
+    my $magic;
+    read($fh, $magic, 8);
+    if ($magic eq "!<arch>\n")
+    {
+        close($fh);
+        return [$path];
+    }
+
+    local $/;
+    my $script = $magic . <$fh>;
+    close($fh);
+    my ($group) = $script =~ /GROUP\s*\(([^)]*)\)/ or return [];
+    my @archives = grep { /\.a$/ && -f $_ } split(/\s+/, $group);
+    return \@archives;
+}
+
+sub bench
+{
+    my @inputs = @_;
+    my $cmd = join(" ", @inputs);
+    my $short = join(" ", map { s{.*/}{}r } @inputs);
+
+    print "Link line: $short\n";
+
+    # resolve
+    my $start = time();
+    my @out = `$resolve --stats --index=bench.idx $cmd 2>bench.stats`;
+    my $wall = time() - $start;
+    open(my $sfh, "<", "bench.stats") or die "bench.stats: $!";
+    my @stats = <$sfh>;
+    close($sfh);
+    unlink "bench.stats";
+
+    printf "  wall %.3fs\n", $wall;
+    for (@stats)
+    {
+        s/^stats: //;
+        s{\S*/}{};
+        print "  $_";
+    }
+
+    my %r_undefined = map { /undefined reference to (\S+)/ ? ($1 => 1) : () } @out;
+    delete $r_undefined{main};
+
+    my %r_defined;
+    my %r_members;
+    for (`$query bench.idx`)
+    {
+        my ($name, $type, $source) = /^(\S+)\s+(\S)\s+(\S+)$/ or next;
+        next unless $type =~ /^[TDC]$/;
+        $r_defined{$name} = $source;
+        $r_members{$source} = 1 if $source =~ /\(/;
+    }
+
+    # ld, tracing every symbol resolve defined.  A name resolve cut to 30
+    # characters is traced under each full name it could be cut from
+    my @full = grep { $r_defined{substr($_, 0, 30)} }
+        map { /^\S+:(?:\S+:)?\s*\S*\s+[A-Za-z]\s+(\S+)$/ ? $1 : () }
+        `nm -A --defined-only $cmd 2>/dev/null`;
+    my %traced = map { $_ => 1 } keys %r_defined, @full;
+    open(my $tfh, ">", "bench.trace") or die "bench.trace: $!";
+    print $tfh "-y $_\n" for sort keys %traced;
+    close($tfh);
+    my @ld = `ld -o /dev/null -e main --noinhibit-exec -Map=bench.map \@bench.trace $cmd 2>&1`;
+
+    my %l_undefined = map { /undefined reference to `([^']+)'/ ? (substr($1, 0, 30) => 1) : () } @ld;
+    my %l_defined;
+    for (@ld)
+    {
+        my ($file, $name) = /^(?:ld: )?(\S+): (?:common )?definition of (\S+)$/ or next;
+        $l_defined{substr($name, 0, 30)}{$file} = 1;
+    }
+
+    my %l_members;
+    open(my $mfh, "<", "bench.map") or die "bench.map: $!";
+    my $in_members = 0;
+    while (<$mfh>)
+    {
+        $in_members = 1, next if /^Archive member included/;
+        last if $in_members && /^(Discarded|Allocating|Memory|As-needed)/;
+        $l_members{$1} = 1 if $in_members && /^(\S+\([^)]+\))/;
+    }
+    close($mfh);
+
+    my $count = compare("pulled members", \%r_members, \%l_members);
+    compare("undefined references", \%r_undefined, \%l_undefined);
+
+    my @differ = grep { !$l_defined{$_} || !$l_defined{$_}{$r_defined{$_}} }
+        sort keys %r_defined;
+    printf "  defining file agrees with ld for %d of %d symbols\n",
+        keys(%r_defined) - @differ, scalar keys %r_defined;
+    print "    differs: @differ[0 .. ($#differ < 4 ? $#differ : 4)]\n"
+        if @differ;
+
+    $count += @differ;
+    print "  $count mismatches\n";
+    return $count;
+}
+
+# print how two sets differ
+# returns the number of entries only in ours
+sub compare
+{
+    my ($what, $ours, $theirs) = @_;
+    my @only_ours = map { s{.*/}{}r } sort grep { !$theirs->{$_} } keys %$ours;
+    my @only_theirs = map { s{.*/}{}r } sort grep { !$ours->{$_} } keys %$theirs;
+    my $both = grep { $theirs->{$_} } keys %$ours;
+
+    printf "  %s: %d match ld, %d only in resolve, %d only in ld\n",
+        $what, $both, scalar @only_ours, scalar @only_theirs;
+    print "    only in resolve: @only_ours[0 .. ($#only_ours < 4 ? $#only_ours : 4)]\n"
+        if @only_ours;
+    print "    only in ld: @only_theirs[0 .. ($#only_theirs < 4 ? $#only_theirs : 4)]\n"
+        if @only_theirs;
+    return scalar @only_ours;
+}
@@ -105,6 +105,137 @@ if (! system "test -s diffs")
 }
 system "rm -f instructor.out student.out diffs";
 
+#resolves without error, inputs from a response file
+system "printf 'main.o libgoo.a\\nlibfoo.a \"libgoo.a\"\\n' > inputs.rsp";
+system "../instrResolve main.o libgoo.a libfoo.a libgoo.a > instructor.out";
+system "../resolve \@inputs.rsp > student.out";
+system "diff instructor.out student.out > diffs";
+if (! system "test -s diffs")
+{
+    print "Failed: ../resolve \@inputs.rsp\n";
+} else
+{
+    print "Passed: ../resolve \@inputs.rsp\n";
+}
+system "rm -f instructor.out student.out diffs inputs.rsp";
 
+#resolves without error, inputs read from stdin
+system "../instrResolve main.o libgoo.a libfoo.a libgoo.a > instructor.out";
+system "printf 'main.o\\nlibgoo.a\\nlibfoo.a\\nlibgoo.a\\n' | ../resolve --inputs-from=- > student.out";
+system "diff instructor.out student.out > diffs";
+if (! system "test -s diffs")
+{
+    print "Failed: ../resolve --inputs-from=-\n";
+} else
+{
+    print "Passed: ../resolve --inputs-from=-\n";
+}
+system "rm -f instructor.out student.out diffs";
 
+#the table written with --index agrees with the defined symbol table
+system "../resolve --index=symbols.idx main.o libfoo.a libgoo.a > student.out";
+system "awk 'NF == 2 { print \$1, \$2 }' student.out | sort > expected.out";
+system "../symbolQuery symbols.idx | awk '{ print \$1, \$2 }' | sort > query.out";
+system "for n in main k goo; do awk -v n=\$n '\$1 == n { print \$1, \$2 }' student.out; done >> expected.out";
+system "echo 'nosuch: not defined' >> expected.out";
+$status = system "../symbolQuery symbols.idx main k goo nosuch > lookup.out";
+system "awk '/not defined/ { print; next } { print \$1, \$2 }' lookup.out >> query.out";
+system "diff expected.out query.out > diffs";
+if ((! system "test -s diffs") || ($status >> 8) != 1)
+{
+    print "Failed: ../resolve --index=symbols.idx main.o libfoo.a libgoo.a\n";
+} else
+{
+    print "Passed: ../resolve --index=symbols.idx main.o libfoo.a libgoo.a\n";
+}
+system "rm -f student.out expected.out query.out lookup.out symbols.idx diffs";
 
+#the --trace timeline is valid JSON and every begin event has its end
+system "../instrResolve main.o libgoo.a libfoo.a libgoo.a > instructor.out";
+system "../resolve --trace=trace.json main.o libgoo.a libfoo.a libgoo.a > student.out";
+system "diff instructor.out student.out > diffs";
+$traced = 0;
+if (open(TRACE, "<", "trace.json"))
+{
+    require JSON::PP;
+    local $/;
+    $trace = eval { JSON::PP::decode_json(<TRACE>) };
+    close(TRACE);
+    %open = ();
+    $traced = defined $trace && $trace->{otherData}{dropped} == 0 &&
+        @{$trace->{traceEvents}} > 0;
+    foreach $event ($traced ? @{$trace->{traceEvents}} : ())
+    {
+        $stack = $open{$event->{tid}} ||= [];
+        if ($event->{ph} eq "B")
+        {
+            push @$stack, "$event->{cat}/$event->{name}";
+        }
+        elsif ($event->{ph} ne "E" || !@$stack ||
+            pop(@$stack) ne "$event->{cat}/$event->{name}")
+        {
+            $traced = 0;
+        }
+    }
+    foreach $stack (values %open)
+    {
+        $traced = 0 if @$stack;
+    }
+}
+if ((! system "test -s diffs") || !$traced)
+{
+    print "Failed: ../resolve --trace=trace.json main.o libgoo.a libfoo.a libgoo.a\n";
+} else
+{
+    print "Passed: ../resolve --trace=trace.json main.o libgoo.a libfoo.a libgoo.a\n";
+}
+system "rm -f instructor.out student.out diffs trace.json";
+
+#the native reader and batched nm agree, whatever the batch size
+system "../instrResolve main.o foo.o libgoo.a libfoo.a libgoo.a > instructor.out";
+system "../resolve --backend=native main.o foo.o libgoo.a libfoo.a libgoo.a > native.out";
+system "../resolve --backend=nm --batch=1 main.o foo.o libgoo.a libfoo.a libgoo.a > nm1.out";
+system "../resolve --backend=nm --batch=256 main.o foo.o libgoo.a libfoo.a libgoo.a > nm256.out";
+system "(diff instructor.out native.out; diff native.out nm1.out; diff native.out nm256.out) > diffs";
+if (! system "test -s diffs")
+{
+    print "Failed: ../resolve --backend=native|nm --batch=1|256\n";
+} else
+{
+    print "Passed: ../resolve --backend=native|nm --batch=1|256\n";
+}
+system "rm -f instructor.out native.out nm1.out nm256.out diffs";
+
+#repeated content is parsed once: the same object twice, a copy of it, a
+#copy of an archive and the same archive again
+system "cp foo.o foocopy.o; cp libgoo.a libgoocopy.a";
+system "../instrResolve main.o foo.o foo.o foocopy.o libgoo.a libgoocopy.a libfoo.a libgoo.a > instructor.out";
+system "../resolve --stats main.o foo.o foo.o foocopy.o libgoo.a libgoocopy.a libfoo.a libgoo.a > student.out 2> stats.out";
+system "diff instructor.out student.out > diffs";
+if ((! system "test -s diffs") || system "grep -q ' [1-9][0-9]* reused by content' stats.out")
+{
+    print "Failed: ../resolve main.o foo.o foo.o foocopy.o libgoo.a libgoocopy.a libfoo.a libgoo.a\n";
+} else
+{
+    print "Passed: ../resolve main.o foo.o foo.o foocopy.o libgoo.a libgoocopy.a libfoo.a libgoo.a\n";
+}
+system "rm -f instructor.out student.out stats.out diffs foocopy.o libgoocopy.a";
+
+#--stream reads the archives in place and gives the same output, with
+#either backend
+foreach $inputs ("main.o libgoofoo.a", "main.o libfoo.a libgoo.a",
+    "main.o libgoo.a libfoo.a", "main.o libgoo.a libfoo.a libgoo.a")
+{
+    system "../resolve $inputs > default.out";
+    system "../resolve --stream $inputs > stream.out";
+    system "../resolve --stream --backend=nm $inputs > streamnm.out";
+    system "(diff default.out stream.out; diff default.out streamnm.out) > diffs";
+    if (! system "test -s diffs")
+    {
+        print "Failed: ../resolve --stream $inputs\n";
+    } else
+    {
+        print "Passed: ../resolve --stream $inputs\n";
+    }
+    system "rm -f default.out stream.out streamnm.out diffs";
+}
@@ -0,0 +1,526 @@
+#include "archiveStream.h"
+#include <sys/stat.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define AR_MAGIC "!<arch>\n"
+#define AR_HEADER_SIZE 60
+#define COPY_CHUNK (1 << 20)
+#define NAME_CHUNK 4096
+
+/*
+ * a member found while walking the archive, order is its position in the
+ * archive and breaks ties between members with the same name
+ */
+typedef struct streamMember
+{
+    char *name;
+    fileSymbols symbols;
+    int order;
+} streamMember;
+
+static char *memberName(int fd, char *raw, char *long_names,
+    uint64_t long_names_off, uint64_t long_names_size, uint64_t *body,
+    uint64_t *body_size);
+static char *readLongName(int fd, uint64_t offset, uint64_t size);
+static char *spoolMember(int fd, uint64_t offset, uint64_t size,
+    uint64_t budget);
+static bool readSpooled(char *filename, streamMember *members, int *pending,
+    char **paths, int count);
+static bool readFully(int fd, void *buffer, uint64_t length, uint64_t offset);
+static int compareMembers(const void *a, const void *b);
+static void *allocate(size_t size);
+
+/*
+ * function:    streamArchive
+ * description: read the symbols of every member of an archive without
+ *              extracting it.  Members are visited in file order and only
+ *              the ranges holding their symbols are read, never more than
+ *              budget bytes at a time.  Pages already visited are dropped
+ *              from the page cache.  Members the native reader cannot parse
+ *              are copied out to temporary files and read with one nm run
+ *              per batch.
+ *
+ *              Members come back sorted by name, and when two members
+ *              share a name only the last one is kept, the same set that
+ *              extracting the archive with ar -x gives.
+ * params:
+ *      filename    the archive's path
+ *      source      the backend, members are only parsed in place by the
+ *                  native one, every member is copied out for nm
+ *      budget      the most bytes to hold in memory for one read
+ *      batch       the most members to copy out for one nm run
+ *      count       set to the number of members
+ *      names       set to a new array of member names
+ *      symbols     set to a new array of the members' symbols
+ * returns:     true on success, false if the file is not an archive this
+ *              reader understands, nothing is returned then
+ */
+bool streamArchive(char *filename, symbolSource *source, uint64_t budget,
+    int batch, int *count, char ***names, fileSymbols **symbols)
+{
+    char magic[8];
+    char header[AR_HEADER_SIZE];
+    char raw[17];
+    char size_field[11];
+    char *long_names = 0;
+    uint64_t long_names_off = 0, long_names_size = 0;
+    uint64_t file_size, offset, next, body, body_size;
+    streamMember *members = 0;
+    char **paths;
+    int *pending;
+    int member_count = 0, capacity = 0, pending_count = 0, i, n;
+    struct stat st;
+    bool ok = true;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    if (fstat(fd, &st) != 0 || !readFully(fd, magic, sizeof(magic), 0) ||
+        memcmp(magic, AR_MAGIC, sizeof(magic)) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    file_size = st.st_size;
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // members waiting for nm, by index as the member array moves
+    if (batch < 1)
+        batch = 1;
+    paths = (char**) allocate(batch * sizeof(char*));
+    pending = (int*) allocate(batch * sizeof(int));
+
+    for (offset = sizeof(magic); ok && offset + AR_HEADER_SIZE <= file_size; offset = next)
+    {
+        if (!readFully(fd, header, AR_HEADER_SIZE, offset) ||
+            header[58] != '`' || header[59] != '\n')
+        {
+            fprintf(stderr, "%s: malformed archive header at %llu\n",
+                filename, (unsigned long long) offset);
+            ok = false;
+            break;
+        }
+
+        memcpy(size_field, header + 48, 10);
+        size_field[10] = '\0';
+        body = offset + AR_HEADER_SIZE;
+        body_size = strtoull(size_field, 0, 10);
+        if (body_size > file_size - body)
+        {
+            fprintf(stderr, "%s: member at %llu runs past the end\n",
+                filename, (unsigned long long) offset);
+            ok = false;
+            break;
+        }
+
+        // members start on even offsets
+        next = body + body_size + ((body + body_size) & 1);
+
+        memcpy(raw, header, 16);
+        raw[16] = '\0';
+        for (n = 15; n >= 0 && raw[n] == ' '; n--)
+            raw[n] = '\0';
+
+        // symbol tables, GNU and BSD
+        if (strcmp(raw, "/") == 0 || strcmp(raw, "/SYM64/") == 0 ||
+            strncmp(raw, "__.SYMDEF", 9) == 0)
+            continue;
+
+        // the GNU long name table, the only thing kept besides summaries,
+        // a table over the budget is left in the file and each name is
+        // read from there instead
+        if (strcmp(raw, "//") == 0)
+        {
+            free(long_names);
+            long_names = 0;
+            long_names_off = body;
+            long_names_size = body_size;
+            if (body_size <= budget)
+            {
+                long_names = (char*) allocate(body_size + 1);
+                ok = readFully(fd, long_names, body_size, body);
+                long_names[body_size] = '\0';
+            }
+            continue;
+        }
+
+        if (member_count == capacity)
+        {
+            capacity = capacity == 0 ? 64 : capacity * 2;
+            members = (streamMember*) realloc(members, capacity * sizeof(streamMember));
+            if (members == 0)
+            {
+                perror("in archiveStream - malloc unable to allocate space");
+                exit(0);
+            }
+        }
+
+        members[member_count].name = memberName(fd, raw, long_names,
+            long_names_off, long_names_size, &body, &body_size);
+        members[member_count].order = member_count;
+        members[member_count].symbols.records = 0;
+        members[member_count].symbols.count = 0;
+        if (source == &nativeSource &&
+            readElfMember(fd, body, body_size, budget, &members[member_count].symbols))
+        {
+            // the records are all that stays resident, so trim them to fit
+            if (members[member_count].symbols.count > 0)
+                members[member_count].symbols.records = (symbolRecord*)
+                    realloc(members[member_count].symbols.records,
+                        members[member_count].symbols.count * sizeof(symbolRecord));
+        }
+        else
+        {
+            paths[pending_count] = spoolMember(fd, body, body_size, budget);
+            if (paths[pending_count] == 0)
+            {
+                fprintf(stderr, "%s: unable to read member %s\n", filename,
+                    members[member_count].name);
+                free(members[member_count].name);
+                ok = false;
+                break;
+            }
+            pending[pending_count++] = member_count;
+        }
+        member_count++;
+
+        if (pending_count == batch)
+        {
+            ok = readSpooled(filename, members, pending, paths, pending_count);
+            pending_count = 0;
+        }
+
+        // done with this member, let its pages go
+        posix_fadvise(fd, offset, next - offset, POSIX_FADV_DONTNEED);
+    }
+
+    if (ok && pending_count > 0)
+        ok = readSpooled(filename, members, pending, paths, pending_count);
+    else
+    {
+        for (i = 0; i < pending_count; i++)
+        {
+            unlink(paths[i]);
+            free(paths[i]);
+        }
+    }
+    free(paths);
+    free(pending);
+    free(long_names);
+    close(fd);
+
+    if (!ok)
+    {
+        for (i = 0; i < member_count; i++)
+        {
+            free(members[i].name);
+            free(members[i].symbols.records);
+        }
+        free(members);
+        return false;
+    }
+
+    qsort(members, member_count, sizeof(streamMember), compareMembers);
+
+    *names = (char**) allocate((member_count + 1) * sizeof(char*));
+    *symbols = (fileSymbols*) allocate((member_count + 1) * sizeof(fileSymbols));
+    *count = 0;
+    for (i = 0; i < member_count; i++)
+    {
+        // of members with the same name keep the last, as ar -x would
+        if (i + 1 < member_count && strcmp(members[i].name, members[i + 1].name) == 0)
+        {
+            free(members[i].name);
+            free(members[i].symbols.records);
+            continue;
+        }
+        (*names)[*count] = members[i].name;
+        (*symbols)[*count] = members[i].symbols;
+        (*count)++;
+    }
+
+    free(members);
+    return true;
+}
+
+/*
+ * function:    memberName
+ * description: work out a member's name from its header, moving the body
+ *              past a BSD style name stored in front of it
+ * params:
+ *      fd              the open archive
+ *      raw             the header's name field, trailing spaces removed
+ *      long_names      the GNU long name table, or 0 if it was not read
+ *      long_names_off  where the table starts in the archive
+ *      long_names_size the table's size, 0 if there is none
+ *      body            the body's offset, updated for BSD names
+ *      body_size       the body's size, updated for BSD names
+ * returns:     a new string with the member's name
+ */
+char *memberName(int fd, char *raw, char *long_names,
+    uint64_t long_names_off, uint64_t long_names_size, uint64_t *body,
+    uint64_t *body_size)
+{
+    uint64_t start, end, len;
+    char *name;
+
+    // GNU long name, an offset into the long name table
+    if (raw[0] == '/' && isdigit((unsigned char) raw[1]) && long_names_size > 0)
+    {
+        start = strtoull(&raw[1], 0, 10);
+        if (start < long_names_size && long_names == 0)
+            return readLongName(fd, long_names_off + start, long_names_size - start);
+        if (start < long_names_size)
+        {
+            for (end = start; end < long_names_size &&
+                long_names[end] != '\n' && long_names[end] != '\0'; end++)
+                ;
+            if (end > start && long_names[end - 1] == '/')
+                end--;
+            name = (char*) allocate(end - start + 1);
+            memcpy(name, long_names + start, end - start);
+            name[end - start] = '\0';
+            return name;
+        }
+    }
+
+    // BSD long name, stored at the start of the body
+    if (strncmp(raw, "#1/", 3) == 0)
+    {
+        len = strtoull(&raw[3], 0, 10);
+        if (len <= *body_size)
+        {
+            name = (char*) allocate(len + 1);
+            if (!readFully(fd, name, len, *body))
+                len = 0;
+            name[len] = '\0';
+            *body += len;
+            *body_size -= len;
+            return name;
+        }
+    }
+
+    // GNU short names end in a slash
+    len = strlen(raw);
+    if (len > 1 && raw[len - 1] == '/')
+        raw[len - 1] = '\0';
+    name = strdup(raw);
+    if (name == 0)
+    {
+        perror("in archiveStream - malloc unable to allocate space");
+        exit(0);
+    }
+    return name;
+}
+
+/*
+ * function:    readLongName
+ * description: read a GNU long name from the table in the file, a chunk
+ *              at a time, for tables too big to hold
+ * params:
+ *      fd      the open archive
+ *      offset  where the name starts
+ *      size    how much of the table is left from there
+ * returns:     a new string with the name
+ */
+char *readLongName(int fd, uint64_t offset, uint64_t size)
+{
+    char chunk[NAME_CHUNK];
+    char *name = 0;
+    uint64_t len = 0, n, i;
+    bool done = false;
+
+    while (!done && len < size)
+    {
+        n = size - len < NAME_CHUNK ? size - len : NAME_CHUNK;
+        if (!readFully(fd, chunk, n, offset + len))
+            break;
+        for (i = 0; i < n && chunk[i] != '\n' && chunk[i] != '\0'; i++)
+            ;
+        done = i < n;
+        name = (char*) realloc(name, len + i + 1);
+        if (name == 0)
+        {
+            perror("in archiveStream - malloc unable to allocate space");
+            exit(0);
+        }
+        memcpy(name + len, chunk, i);
+        len += i;
+    }
+
+    if (name == 0)
+        name = (char*) allocate(1);
+    if (len > 0 && name[len - 1] == '/')
+        len--;
+    name[len] = '\0';
+    return name;
+}
+
+/*
+ * function:    spoolMember
+ * description: copy a member to a temporary file a chunk at a time, for
+ *              nm to read
+ * params:
+ *      fd          the open archive
+ *      offset      where the member starts
+ *      size        the member's size
+ *      budget      the most bytes to hold in memory at once
+ * returns:     a new string with the file's path, or 0 on error
+ */
+char *spoolMember(int fd, uint64_t offset, uint64_t size, uint64_t budget)
+{
+    char *path;
+    uint64_t chunk = budget < COPY_CHUNK ? budget : COPY_CHUNK;
+    uint64_t done, n;
+    char *buffer;
+    bool ok = true;
+    int out;
+
+    if (chunk == 0)
+        return 0;
+
+    path = strdup(".tmp.memberXXXXXX");
+    if (path == 0)
+    {
+        perror("in archiveStream - malloc unable to allocate space");
+        exit(0);
+    }
+    out = mkstemp(path);
+    if (out < 0)
+    {
+        free(path);
+        return 0;
+    }
+
+    buffer = (char*) allocate(chunk);
+    for (done = 0; ok && done < size; done += n)
+    {
+        n = size - done < chunk ? size - done : chunk;
+        ok = readFully(fd, buffer, n, offset + done) &&
+            write(out, buffer, n) == (ssize_t) n;
+    }
+    free(buffer);
+    close(out);
+
+    if (!ok)
+    {
+        unlink(path);
+        free(path);
+        return 0;
+    }
+    return path;
+}
+
+/*
+ * function:    readSpooled
+ * description: read a batch of copied out members with one nm run, then
+ *              remove the copies
+ * params:
+ *      filename    the archive's path, for errors
+ *      members     the members found so far
+ *      pending     the index in members of each copied out member
+ *      paths       the copies' paths, freed here
+ *      count       how many members are in the batch
+ * returns:     true on success, false otherwise
+ */
+bool readSpooled(char *filename, streamMember *members, int *pending,
+    char **paths, int count)
+{
+    fileSymbols *found = (fileSymbols*) allocate(count * sizeof(fileSymbols));
+    bool ok = nmSource.read(paths, count, found);
+    fileSymbols *symbols;
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        unlink(paths[i]);
+        free(paths[i]);
+        if (!ok)
+            continue;
+
+        symbols = &members[pending[i]].symbols;
+        *symbols = found[i];
+        if (symbols->count > 0)
+            symbols->records = (symbolRecord*) realloc(symbols->records,
+                symbols->count * sizeof(symbolRecord));
+    }
+
+    if (!ok)
+    {
+        if (count == 1)
+            fprintf(stderr, "%s: unable to read member %s\n", filename,
+                members[pending[0]].name);
+        else
+            fprintf(stderr, "%s: unable to read members %s to %s\n",
+                filename, members[pending[0]].name,
+                members[pending[count - 1]].name);
+    }
+
+    free(found);
+    return ok;
+}
+
+/*
+ * function:    readFully
+ * description: pread until the whole range has been read
+ * params:
+ *      fd      the file
+ *      buffer  where to put the bytes
+ *      length  how many bytes to read
+ *      offset  where to read from
+ * returns:     true on success, false on error or end of file
+ */
+bool readFully(int fd, void *buffer, uint64_t length, uint64_t offset)
+{
+    uint64_t done = 0;
+    ssize_t n;
+
+    while (done < length)
+    {
+        n = pread(fd, (char*) buffer + done, length - done, offset + done);
+        if (n <= 0)
+            return false;
+        done += n;
+    }
+
+    return true;
+}
+
+/*
+ * function:    compareMembers
+ * description: qsort comparison of members by name, then archive order
+ */
+int compareMembers(const void *a, const void *b)
+{
+    const streamMember *x = (const streamMember*) a;
+    const streamMember *y = (const streamMember*) b;
+    int c = strcmp(x->name, y->name);
+
+    if (c != 0)
+        return c;
+    return x->order - y->order;
+}
+
+/*
+ * function:    allocate
+ * description: malloc that exits when out of memory
+ */
+void *allocate(size_t size)
+{
+    void *p = malloc(size == 0 ? 1 : size);
+
+    if (p == 0)
+    {
+        perror("in archiveStream - malloc unable to allocate space");
+        exit(0);
+    }
+    return p;
+}
@@ -0,0 +1,36 @@
+#ifndef ARCHIVESTREAM_H
+#define ARCHIVESTREAM_H
+
+#include <stdint.h>
+#include "symbolSource.h"
+#include "bool.h"
+
+/*
+ * function:    streamArchive
+ * description: read the symbols of every member of an archive without
+ *              extracting it.  Members are visited in file order and only
+ *              the ranges holding their symbols are read, never more than
+ *              budget bytes at a time.  Pages already visited are dropped
+ *              from the page cache.  Members the native reader cannot parse
+ *              are copied out to temporary files and read with one nm run
+ *              per batch.
+ *
+ *              Members come back sorted by name, and when two members
+ *              share a name only the last one is kept, the same set that
+ *              extracting the archive with ar -x gives.
+ * params:
+ *      filename    the archive's path
+ *      source      the backend, members are only parsed in place by the
+ *                  native one, every member is copied out for nm
+ *      budget      the most bytes to hold in memory for one read
+ *      batch       the most members to copy out for one nm run
+ *      count       set to the number of members
+ *      names       set to a new array of member names
+ *      symbols     set to a new array of the members' symbols
+ * returns:     true on success, false if the file is not an archive this
+ *              reader understands, nothing is returned then
+ */
+bool streamArchive(char *filename, symbolSource *source, uint64_t budget,
+    int batch, int *count, char ***names, fileSymbols **symbols);
+
+#endif
@@ -0,0 +1,241 @@
+#include "contentHash.h"
+#include <stdio.h>
+#include <string.h>
+
+#define PRIME1 11400714785074694791ull
+#define PRIME2 14029467366897019727ull
+#define PRIME3 1609587929392839161ull
+#define PRIME4 9650029242287828579ull
+#define PRIME5 2870177450012600261ull
+
+static uint64_t rotl(uint64_t x, int r);
+static uint64_t read64(const unsigned char *p);
+static uint32_t read32(const unsigned char *p);
+static uint64_t round64(uint64_t acc, uint64_t input);
+static uint64_t mergeRound(uint64_t acc, uint64_t val);
+
+/*
+ * function:    contentHashInit
+ * description: start a new hash
+ * params:
+ *      state   the state to initialize
+ *      seed    the hash seed
+ * returns:     void
+ */
+void contentHashInit(contentHashState *state, uint64_t seed)
+{
+    state->v[0] = seed + PRIME1 + PRIME2;
+    state->v[1] = seed + PRIME2;
+    state->v[2] = seed;
+    state->v[3] = seed - PRIME1;
+    state->total = 0;
+    state->buffered = 0;
+    state->seed = seed;
+}
+
+/*
+ * function:    contentHashUpdate
+ * description: add bytes to a hash
+ * params:
+ *      state   the hash state
+ *      data    the bytes to add
+ *      size    the number of bytes
+ * returns:     void
+ */
+void contentHashUpdate(contentHashState *state, const void *data, size_t size)
+{
+    const unsigned char *p = (const unsigned char*) data;
+    size_t fill;
+
+    state->total += size;
+
+    // top up a partial stripe first
+    if (state->buffered > 0)
+    {
+        fill = 32 - state->buffered;
+        if (fill > size)
+            fill = size;
+        memcpy(state->buffer + state->buffered, p, fill);
+        state->buffered += fill;
+        p += fill;
+        size -= fill;
+        if (state->buffered < 32)
+            return;
+
+        state->v[0] = round64(state->v[0], read64(state->buffer));
+        state->v[1] = round64(state->v[1], read64(state->buffer + 8));
+        state->v[2] = round64(state->v[2], read64(state->buffer + 16));
+        state->v[3] = round64(state->v[3], read64(state->buffer + 24));
+        state->buffered = 0;
+    }
+
+    // then whole stripes straight from the input
+    while (size >= 32)
+    {
+        state->v[0] = round64(state->v[0], read64(p));
+        state->v[1] = round64(state->v[1], read64(p + 8));
+        state->v[2] = round64(state->v[2], read64(p + 16));
+        state->v[3] = round64(state->v[3], read64(p + 24));
+        p += 32;
+        size -= 32;
+    }
+
+    memcpy(state->buffer, p, size);
+    state->buffered = size;
+}
+
+/*
+ * function:    contentHashDigest
+ * description: finish a hash, the state can keep being updated afterwards
+ * params:
+ *      state   the hash state
+ * returns:     the hash of everything added so far
+ */
+uint64_t contentHashDigest(contentHashState *state)
+{
+    const unsigned char *p = state->buffer;
+    size_t left = state->buffered;
+    uint64_t h;
+
+    if (state->total >= 32)
+    {
+        h = rotl(state->v[0], 1) + rotl(state->v[1], 7) +
+            rotl(state->v[2], 12) + rotl(state->v[3], 18);
+        h = mergeRound(h, state->v[0]);
+        h = mergeRound(h, state->v[1]);
+        h = mergeRound(h, state->v[2]);
+        h = mergeRound(h, state->v[3]);
+    }
+    else
+        h = state->seed + PRIME5;
+
+    h += state->total;
+
+    while (left >= 8)
+    {
+        h ^= round64(0, read64(p));
+        h = rotl(h, 27) * PRIME1 + PRIME4;
+        p += 8;
+        left -= 8;
+    }
+    if (left >= 4)
+    {
+        h ^= (uint64_t) read32(p) * PRIME1;
+        h = rotl(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+        left -= 4;
+    }
+    while (left > 0)
+    {
+        h ^= *p++ * PRIME5;
+        h = rotl(h, 11) * PRIME1;
+        left--;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+/*
+ * function:    hashContent
+ * description: hash a block of memory
+ * params:
+ *      data    the bytes to hash
+ *      size    the number of bytes
+ * returns:     the hash
+ */
+uint64_t hashContent(const void *data, size_t size)
+{
+    contentHashState state;
+
+    contentHashInit(&state, 0);
+    contentHashUpdate(&state, data, size);
+    return contentHashDigest(&state);
+}
+
+/*
+ * function:    hashFile
+ * description: hash the contents of a file
+ * params:
+ *      filename    the file to hash
+ *      hash        set to the hash of the file's contents
+ *      size        set to the file's size
+ * returns:     true on success, false if the file could not be read
+ */
+bool hashFile(char *filename, uint64_t *hash, uint64_t *size)
+{
+    unsigned char buffer[65536];
+    contentHashState state;
+    size_t n;
+    bool ok;
+    FILE *fp;
+
+    fp = fopen(filename, "rb");
+    if (fp == NULL)
+        return false;
+
+    contentHashInit(&state, 0);
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        contentHashUpdate(&state, buffer, n);
+    ok = !ferror(fp);
+    fclose(fp);
+
+    *hash = contentHashDigest(&state);
+    *size = state.total;
+    return ok;
+}
+
+/*
+ * function:    rotl
+ * description: rotate a 64 bit value left
+ */
+uint64_t rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+/*
+ * function:    read64
+ * description: read a little endian 64 bit value
+ */
+uint64_t read64(const unsigned char *p)
+{
+    return (uint64_t) p[0] | (uint64_t) p[1] << 8 | (uint64_t) p[2] << 16 |
+        (uint64_t) p[3] << 24 | (uint64_t) p[4] << 32 | (uint64_t) p[5] << 40 |
+        (uint64_t) p[6] << 48 | (uint64_t) p[7] << 56;
+}
+
+/*
+ * function:    read32
+ * description: read a little endian 32 bit value
+ */
+uint32_t read32(const unsigned char *p)
+{
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 |
+        (uint32_t) p[3] << 24;
+}
+
+/*
+ * function:    round64
+ * description: mix one 64 bit lane of input into an accumulator
+ */
+uint64_t round64(uint64_t acc, uint64_t input)
+{
+    acc += input * PRIME2;
+    acc = rotl(acc, 31);
+    return acc * PRIME1;
+}
+
+/*
+ * function:    mergeRound
+ * description: fold an accumulator into the final hash
+ */
+uint64_t mergeRound(uint64_t acc, uint64_t val)
+{
+    acc ^= round64(0, val);
+    return acc * PRIME1 + PRIME4;
+}
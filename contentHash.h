@@ -0,0 +1,72 @@
+#ifndef CONTENTHASH_H
+#define CONTENTHASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bool.h"
+
+/*
+ * state for hashing content that arrives in pieces, the result is XXH64
+ * of all the bytes added
+ */
+typedef struct contentHashState
+{
+    uint64_t v[4];
+    uint64_t total;
+    unsigned char buffer[32];
+    size_t buffered;
+    uint64_t seed;
+} contentHashState;
+
+/*
+ * function:    contentHashInit
+ * description: start a new hash
+ * params:
+ *      state   the state to initialize
+ *      seed    the hash seed
+ * returns:     void
+ */
+void contentHashInit(contentHashState *state, uint64_t seed);
+
+/*
+ * function:    contentHashUpdate
+ * description: add bytes to a hash
+ * params:
+ *      state   the hash state
+ *      data    the bytes to add
+ *      size    the number of bytes
+ * returns:     void
+ */
+void contentHashUpdate(contentHashState *state, const void *data, size_t size);
+
+/*
+ * function:    contentHashDigest
+ * description: finish a hash, the state can keep being updated afterwards
+ * params:
+ *      state   the hash state
+ * returns:     the hash of everything added so far
+ */
+uint64_t contentHashDigest(contentHashState *state);
+
+/*
+ * function:    hashContent
+ * description: hash a block of memory
+ * params:
+ *      data    the bytes to hash
+ *      size    the number of bytes
+ * returns:     the hash
+ */
+uint64_t hashContent(const void *data, size_t size);
+
+/*
+ * function:    hashFile
+ * description: hash the contents of a file
+ * params:
+ *      filename    the file to hash
+ *      hash        set to the hash of the file's contents
+ *      size        set to the file's size
+ * returns:     true on success, false if the file could not be read
+ */
+bool hashFile(char *filename, uint64_t *hash, uint64_t *size);
+
+#endif
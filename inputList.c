@@ -0,0 +1,258 @@
+#include "inputList.h"
+#include <sys/types.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define INPUT_CHUNK 65536
+
+/*
+ * a file read a chunk at a time
+ */
+typedef struct inputStream
+{
+    int fd;
+    char *buffer;
+    int length;
+    int pos;
+    void (*idle)();
+} inputStream;
+
+/*
+ * the argument or line being read
+ */
+typedef struct inputWord
+{
+    char *text;
+    int length;
+    int capacity;
+} inputWord;
+
+static bool openStream(inputStream *in, char *filename, void (*idle)());
+static void closeStream(inputStream *in);
+static int nextChar(inputStream *in);
+static void addChar(inputWord *word, int c);
+static void handleWord(inputWord *word, void (*handle)(char *));
+
+/*
+ * function:    readResponseFile
+ * description: read the arguments in a GNU style response file, separated
+ *              by white space, where quotes and backslashes keep white
+ *              space in an argument
+ * params:
+ *      filename    the response file
+ *      handle      called with each argument
+ *      idle        called before waiting for more of the file, or 0
+ * returns:     true on success, false if the file could not be opened
+ */
+bool readResponseFile(char *filename, void (*handle)(char *arg),
+    void (*idle)())
+{
+    inputStream in;
+    inputWord word = { 0, 0, 0 };
+    bool in_word = false;
+    int quote = 0;
+    int c;
+
+    if (!openStream(&in, filename, idle))
+        return false;
+
+    while ((c = nextChar(&in)) != EOF)
+    {
+        if (c == '\\')
+        {
+            // the next character is taken as it is
+            c = nextChar(&in);
+            if (c == EOF)
+                break;
+            addChar(&word, c);
+            in_word = true;
+        }
+        else if (quote != 0)
+        {
+            if (c == quote)
+                quote = 0;
+            else
+                addChar(&word, c);
+        }
+        else if (c == '\'' || c == '"')
+        {
+            quote = c;
+            in_word = true;
+        }
+        else if (isspace(c))
+        {
+            // an argument ends at white space, '' is an empty argument
+            if (in_word)
+                handleWord(&word, handle);
+            in_word = false;
+        }
+        else
+        {
+            addChar(&word, c);
+            in_word = true;
+        }
+    }
+
+    if (in_word)
+        handleWord(&word, handle);
+
+    free(word.text);
+    closeStream(&in);
+    return true;
+}
+
+/*
+ * function:    readInputList
+ * description: read file names one per line, empty lines are skipped
+ * params:
+ *      filename    the list, or "-" for stdin
+ *      handle      called with each file name
+ *      idle        called before waiting for more of the list, or 0
+ * returns:     true on success, false if the list could not be opened
+ */
+bool readInputList(char *filename, void (*handle)(char *name),
+    void (*idle)())
+{
+    inputStream in;
+    inputWord word = { 0, 0, 0 };
+    int c;
+
+    if (!openStream(&in, filename, idle))
+        return false;
+
+    while ((c = nextChar(&in)) != EOF)
+    {
+        if (c != '\n')
+            addChar(&word, c);
+        else if (word.length > 0)
+            handleWord(&word, handle);
+    }
+
+    if (word.length > 0)
+        handleWord(&word, handle);
+
+    free(word.text);
+    closeStream(&in);
+    return true;
+}
+
+/*
+ * function:    openStream
+ * description: open a file to read in chunks
+ * params:
+ *      in          the stream to set up
+ *      filename    the file, "-" for stdin
+ *      idle        called before a read that would wait, or 0
+ * returns:     true on success, false if the file could not be opened
+ */
+bool openStream(inputStream *in, char *filename, void (*idle)())
+{
+    if (strcmp(filename, "-") == 0)
+        in->fd = 0;
+    else
+        in->fd = open(filename, O_RDONLY);
+    if (in->fd < 0)
+        return false;
+
+    in->buffer = (char*) malloc(INPUT_CHUNK);
+    if (in->buffer == 0)
+    {
+        perror("in inputList - malloc unable to allocate space");
+        exit(0);
+    }
+    in->length = 0;
+    in->pos = 0;
+    in->idle = idle;
+    return true;
+}
+
+/*
+ * function:    closeStream
+ * description: close a stream, stdin is left open
+ */
+void closeStream(inputStream *in)
+{
+    if (in->fd != 0)
+        close(in->fd);
+    free(in->buffer);
+}
+
+/*
+ * function:    nextChar
+ * description: read the next character, when the chunk is used up and
+ *              the next read would wait the idle function is called first
+ * params:
+ *      in  the stream
+ * returns:     the character, or EOF at the end or on an error
+ */
+int nextChar(inputStream *in)
+{
+    struct pollfd ready;
+    ssize_t n;
+
+    if (in->pos == in->length)
+    {
+        ready.fd = in->fd;
+        ready.events = POLLIN;
+        if (in->idle != 0 && poll(&ready, 1, 0) == 0)
+            in->idle();
+
+        do
+            n = read(in->fd, in->buffer, INPUT_CHUNK);
+        while (n < 0 && errno == EINTR);
+
+        if (n <= 0)
+            return EOF;
+        in->length = n;
+        in->pos = 0;
+    }
+
+    return (unsigned char) in->buffer[in->pos++];
+}
+
+/*
+ * function:    addChar
+ * description: add a character to the word being read
+ */
+void addChar(inputWord *word, int c)
+{
+    if (word->length + 1 >= word->capacity)
+    {
+        word->capacity = word->capacity == 0 ? 256 : word->capacity * 2;
+        word->text = (char*) realloc(word->text, word->capacity);
+        if (word->text == 0)
+        {
+            perror("in inputList - malloc unable to allocate space");
+            exit(0);
+        }
+    }
+    word->text[word->length++] = c;
+}
+
+/*
+ * function:    handleWord
+ * description: pass a copy of the word read to the handler and start the
+ *              next one
+ */
+void handleWord(inputWord *word, void (*handle)(char *))
+{
+    char *copy = (char*) malloc(word->length + 1);
+
+    if (copy == 0)
+    {
+        perror("in inputList - malloc unable to allocate space");
+        exit(0);
+    }
+    if (word->length > 0)
+        memcpy(copy, word->text, word->length);
+    copy[word->length] = '\0';
+    word->length = 0;
+
+    handle(copy);
+}
@@ -0,0 +1,41 @@
+#ifndef INPUTLIST_H
+#define INPUTLIST_H
+
+#include "bool.h"
+
+/*
+ * Inputs named in a file rather than on the command line.  Both readers
+ * hand each name over as soon as it has been read, so the caller can start
+ * on it while the rest of the file is still being written.  Before a read
+ * that would have to wait for more data, idle is called, if given, so the
+ * caller can get on with work it has been holding back.  Names are given
+ * as new strings that belong to the caller.
+ */
+
+/*
+ * function:    readResponseFile
+ * description: read the arguments in a GNU style response file, separated
+ *              by white space, where quotes and backslashes keep white
+ *              space in an argument
+ * params:
+ *      filename    the response file
+ *      handle      called with each argument
+ *      idle        called before waiting for more of the file, or 0
+ * returns:     true on success, false if the file could not be opened
+ */
+bool readResponseFile(char *filename, void (*handle)(char *arg),
+    void (*idle)());
+
+/*
+ * function:    readInputList
+ * description: read file names one per line, empty lines are skipped
+ * params:
+ *      filename    the list, or "-" for stdin
+ *      handle      called with each file name
+ *      idle        called before waiting for more of the list, or 0
+ * returns:     true on success, false if the list could not be opened
+ */
+bool readInputList(char *filename, void (*handle)(char *name),
+    void (*idle)());
+
+#endif
@@ -0,0 +1,329 @@
+#include "perfCounters.h"
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PERF_COUNTERS 4
+
+typedef struct perfPhase
+{
+    char name[PERF_PHASE_NAME_LEN];
+    uint64_t counts[PERF_COUNTERS];
+    int runs;
+} perfPhase;
+
+/*
+ * what a PERF_FORMAT_GROUP read returns, the times let counts be scaled
+ * up when the kernel had to multiplex the counters
+ */
+typedef struct perfReading
+{
+    uint64_t nr;
+    uint64_t time_enabled;
+    uint64_t time_running;
+    uint64_t values[PERF_COUNTERS];
+} perfReading;
+
+/*
+ * what a read of one counter that is not in a group returns
+ */
+typedef struct perfValue
+{
+    uint64_t value;
+    uint64_t time_enabled;
+    uint64_t time_running;
+} perfValue;
+
+static const char *counter_names[PERF_COUNTERS] =
+    { "cycles", "instructions", "cache-misses", "branch-misses" };
+static const uint64_t counter_configs[PERF_COUNTERS] =
+    { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+
+// position of each counter in a group read, or -1 if it is not open
+static int slots[PERF_COUNTERS] = { -1, -1, -1, -1 };
+static int fds[PERF_COUNTERS] = { -1, -1, -1, -1 };
+static int leader = -1;
+static int open_count = 0;
+
+// inherited counters also count the threads started after they were
+// opened, but not the commands run through system and popen, which are
+// forked rather than cloned as threads.  The kernel will not read them as
+// a group, so each is read on its own
+static bool inherited = false;
+static bool requested = false;
+static int open_errno = 0;
+
+static perfPhase phases[PERF_MAX_PHASES];
+static int phase_count = 0;
+static perfPhase *cur_phase = 0;
+static perfReading start;
+
+static bool openCounters(bool inherit);
+static bool readCounters(perfReading *reading);
+static uint64_t scaleCount(uint64_t value, uint64_t enabled, uint64_t running);
+
+/*
+ * function:    perfOpen
+ * description: open the cycle, instruction, cache miss and branch miss
+ *              counters, counters the kernel will not give us are left out.
+ *              Call it before starting any threads, so that they are
+ *              counted too
+ * returns:     true if at least one counter is available, false otherwise
+ */
+bool perfOpen()
+{
+    int i;
+
+    requested = true;
+    if (open_count > 0)
+        return true;
+
+    // fall back to a group on this thread alone if the kernel will not
+    // let the counters follow new threads
+    if (!openCounters(true) && !openCounters(false))
+        return false;
+
+    if (inherited)
+    {
+        for (i = 0; i < PERF_COUNTERS; i++)
+        {
+            if (fds[i] < 0)
+                continue;
+            ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    else
+    {
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    return true;
+}
+
+/*
+ * function:    perfBegin
+ * description: start counting a phase, does nothing unless perfOpen
+ *              succeeded
+ * params:
+ *      phase   the phase's name, copied
+ * returns:     void
+ */
+void perfBegin(const char *phase)
+{
+    int i;
+
+    if (open_count == 0)
+        return;
+
+    for (i = 0; i < phase_count; i++)
+        if (strcmp(phases[i].name, phase) == 0)
+            break;
+
+    // past the limit, counts go to the last phase
+    if (i == phase_count)
+    {
+        if (phase_count < PERF_MAX_PHASES)
+        {
+            strncpy(phases[i].name, phase, PERF_PHASE_NAME_LEN - 1);
+            phase_count++;
+        }
+        else
+            i = PERF_MAX_PHASES - 1;
+    }
+
+    cur_phase = &phases[i];
+    if (!readCounters(&start))
+        cur_phase = 0;
+}
+
+/*
+ * function:    perfEnd
+ * description: stop counting the phase begun last and add the counts to
+ *              its totals
+ * returns:     void
+ */
+void perfEnd()
+{
+    perfReading end;
+    int i;
+
+    if (cur_phase == 0)
+        return;
+
+    if (readCounters(&end))
+    {
+        for (i = 0; i < PERF_COUNTERS; i++)
+            if (slots[i] >= 0)
+                cur_phase->counts[i] += end.values[slots[i]] - start.values[slots[i]];
+        cur_phase->runs++;
+    }
+    cur_phase = 0;
+}
+
+/*
+ * function:    perfReport
+ * description: print the counts for every phase to stderr, or why there
+ *              are none
+ * returns:     void
+ */
+void perfReport()
+{
+    perfPhase *p;
+    int i, j;
+
+    if (!requested)
+        return;
+
+    if (open_count == 0)
+    {
+        fprintf(stderr, "perf: counters unavailable: %s%s\n",
+            strerror(open_errno),
+            open_errno == EACCES || open_errno == EPERM ?
+                " (check /proc/sys/kernel/perf_event_paranoid)" :
+            open_errno == ENOENT || open_errno == EOPNOTSUPP ?
+                " (no hardware counters, common in VMs and containers)" : "");
+        return;
+    }
+
+    for (i = 0; i < PERF_COUNTERS; i++)
+        if (slots[i] < 0)
+            fprintf(stderr, "perf: %s counter unavailable\n", counter_names[i]);
+    if (!inherited)
+        fprintf(stderr, "perf: counting the main thread only, worker threads "
+            "are not included\n");
+
+    fprintf(stderr, "perf: %-32s %5s %14s %14s %5s %12s %12s\n", "phase", "runs",
+        counter_names[0], counter_names[1], "IPC", counter_names[2],
+        counter_names[3]);
+
+    for (i = 0; i < phase_count; i++)
+    {
+        p = &phases[i];
+        fprintf(stderr, "perf: %-32.32s %5d", p->name, p->runs);
+        for (j = 0; j < PERF_COUNTERS; j++)
+        {
+            if (j == 2)
+            {
+                if (slots[0] >= 0 && slots[1] >= 0 && p->counts[0] > 0)
+                    fprintf(stderr, " %5.2f", (double) p->counts[1] / p->counts[0]);
+                else
+                    fprintf(stderr, " %5s", "-");
+            }
+            if (slots[j] < 0)
+                fprintf(stderr, " %*s", j < 2 ? 14 : 12, "-");
+            else
+                fprintf(stderr, " %*llu", j < 2 ? 14 : 12,
+                    (unsigned long long) p->counts[j]);
+        }
+        fprintf(stderr, "\n");
+    }
+}
+
+/*
+ * function:    openCounters
+ * description: open the counters, either each on its own and inherited by
+ *              new threads but not by child processes, or as a group led
+ *              by the first that opens
+ * params:
+ *      inherit true to open inherited counters
+ * returns:     true if at least one counter opened, false otherwise
+ */
+bool openCounters(bool inherit)
+{
+    struct perf_event_attr attr;
+    int i, fd;
+
+    for (i = 0; i < PERF_COUNTERS; i++)
+    {
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = counter_configs[i];
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+            PERF_FORMAT_TOTAL_TIME_RUNNING;
+        if (!inherit)
+            attr.read_format |= PERF_FORMAT_GROUP;
+        attr.inherit = inherit;
+        attr.inherit_thread = inherit;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.disabled = inherit || leader < 0;
+
+        // the first counter that opens leads the group, so that the
+        // others are scheduled with it
+        fd = (int) syscall(SYS_perf_event_open, &attr, 0, -1,
+            inherit ? -1 : leader, 0);
+        if (fd < 0)
+        {
+            open_errno = errno;
+            continue;
+        }
+
+        if (!inherit && leader < 0)
+            leader = fd;
+        fds[i] = fd;
+        slots[i] = open_count++;
+    }
+
+    inherited = inherit && open_count > 0;
+    return open_count > 0;
+}
+
+/*
+ * function:    readCounters
+ * description: read the counters, scaling the counts if they were only
+ *              running part of the time
+ * params:
+ *      reading gets the counts
+ * returns:     true on success, false otherwise
+ */
+bool readCounters(perfReading *reading)
+{
+    perfValue one;
+    int i;
+
+    memset(reading, 0, sizeof(*reading));
+
+    if (inherited)
+    {
+        for (i = 0; i < PERF_COUNTERS; i++)
+        {
+            if (fds[i] < 0)
+                continue;
+            if (read(fds[i], &one, sizeof(one)) != (ssize_t) sizeof(one))
+                return false;
+            reading->values[slots[i]] = scaleCount(one.value,
+                one.time_enabled, one.time_running);
+        }
+        return true;
+    }
+
+    if (read(leader, reading, sizeof(*reading)) < (ssize_t) (3 * sizeof(uint64_t)))
+        return false;
+
+    for (i = 0; i < open_count; i++)
+        reading->values[i] = scaleCount(reading->values[i],
+            reading->time_enabled, reading->time_running);
+
+    return true;
+}
+
+/*
+ * function:    scaleCount
+ * description: scale a count up to the whole time it was enabled, when
+ *              the kernel had to multiplex it with other counters
+ * returns:     the scaled count
+ */
+uint64_t scaleCount(uint64_t value, uint64_t enabled, uint64_t running)
+{
+    if (running > 0 && running < enabled)
+        return (uint64_t) ((double) value * enabled / running);
+    return value;
+}
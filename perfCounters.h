@@ -0,0 +1,52 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include "bool.h"
+
+/*
+ * Hardware counters read around named phases of a run.  Counts for phases
+ * with the same name are added together.  The counters count this process
+ * in user space, with the threads it starts after perfOpen when the kernel
+ * lets counters be inherited by threads alone, and only the calling thread
+ * otherwise.  nm and the other commands resolve runs are never included.
+ */
+#define PERF_MAX_PHASES 64
+#define PERF_PHASE_NAME_LEN 64
+
+/*
+ * function:    perfOpen
+ * description: open the cycle, instruction, cache miss and branch miss
+ *              counters, counters the kernel will not give us are left out.
+ *              Call it before starting any threads, so that they are
+ *              counted too
+ * returns:     true if at least one counter is available, false otherwise
+ */
+bool perfOpen();
+
+/*
+ * function:    perfBegin
+ * description: start counting a phase, does nothing unless perfOpen
+ *              succeeded
+ * params:
+ *      phase   the phase's name, copied
+ * returns:     void
+ */
+void perfBegin(const char *phase);
+
+/*
+ * function:    perfEnd
+ * description: stop counting the phase begun last and add the counts to
+ *              its totals
+ * returns:     void
+ */
+void perfEnd();
+
+/*
+ * function:    perfReport
+ * description: print the counts for every phase to stderr, or why there
+ *              are none
+ * returns:     void
+ */
+void perfReport();
+
+#endif
@@ -9,6 +9,8 @@
  *              in a object file within an archive, then all symbols in that
  *              archived object file are added to one of the two lists; 
  *              otherwise, no symbols from that archive member are added.  
+ *              Each member is applied once and its changes are logged, a
+ *              member that resolves nothing has them rolled back.
  *              Members of an archive are visited repeatedly until there are 
  *              no changes in the lists of defined and undefined symbols.
  *
@@ -20,71 +22,539 @@
  *              the main function is defined and if not, an error message is
  *              displayed.  Next, the program prints out the entries of the 
  *              undefined symbols list with an error message for each one.
+ *
+ *              With --index=FILE the defined symbols, their types and the
+ *              file each came from are also written to a binary index that
+ *              symbolQuery can answer lookups from.  With --trace=FILE a
+ *              timeline of the inputs, archive passes and archive members
+ *              is written in trace event JSON for a trace viewer.
+ *
+ *              Symbols are read with an in process ELF reader, anything it
+ *              cannot read is handed to nm -A a batch of files at a time.
+ *              --backend=nm uses nm for everything and --batch=N sets how
+ *              many files go to one backend call.  Inputs and archive
+ *              members are hashed by content, so an archive named twice or
+ *              a member repeated byte for byte is only extracted and read
+ *              once, though every occurrence is still resolved in order.
+ *              --stream skips the member hashing, as it would have to read
+ *              every member whole.
+ *
+ *              --perf-counters reads the hardware counters around object
+ *              ingest, archive loading, each archive's passes and output.
+ *
+ *              Names are interned in a sharded symbolTable by --threads=N
+ *              worker threads as each batch of files is read, the table
+ *              then finds a name's U and D entries while resolution runs
+ *              on this thread in link order.
+ *
+ *              Inputs may also be listed in GNU style @file response files
+ *              or, one per line, in the file given by --inputs-from=FILE,
+ *              - for stdin.  They are resolved in their place as they are
+ *              read, queued object files are read whenever the list has to
+ *              wait for its writer.
+ *
+ *              With --stream archives are not copied and extracted; their
+ *              members are read in place, holding no more than the
+ *              --mem-budget of any member in memory, and only the members'
+ *              symbol records stay resident.
  */
 
 #include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "symbolList.h"
+#include "symbolIndex.h"
+#include "symbolSource.h"
+#include "archiveStream.h"
+#include "inputList.h"
+#include "contentHash.h"
+#include "trace.h"
+#include "perfCounters.h"
 #include "bool.h"
 
+/*
+ * the members of an archive and their symbols, kept so that an archive
+ * named again on the command line is not extracted and read again
+ */
+typedef struct archiveMembers
+{
+    uint64_t hash;
+    uint64_t size;
+    int count;
+    char **names;
+    fileSymbols *symbols;
+} archiveMembers;
+
+/*
+ * what the lists held for a name when a symbol was processed
+ */
+typedef struct symbolLookup
+{
+    int in_u;
+    int in_d;
+    char d_type;
+} symbolLookup;
+
+/*
+ * a change made while an archive member is applied speculatively, with
+ * what is needed to take it back if the member is not pulled
+ */
+typedef struct undoEntry
+{
+    // 'r' entry was removed from U after prev, 'u' entry in D had type and
+    // source before it was updated, 'a' symbol was appended to U, 'd'
+    // symbol was appended to D after prev, its last entry, 'l' renamed
+    // local entry was appended to D and is interned if the member is kept,
+    // 'm' a multiple definition of name is waiting to be reported
+    char kind;
+    symbolName *symbol;
+    symbolEntry *entry;
+    symbolEntry *prev;
+    char type;
+    char *source;
+    char *name;
+} undoEntry;
+
+/*
+ * files whose symbol names are being interned, worker threads take the
+ * next file until none are left
+ */
+typedef struct internJob
+{
+    fileSymbols *files;
+    int count;
+    int next;
+} internJob;
+
 static symbolList u_list = END_OF_LIST;
 static symbolList d_list = END_OF_LIST;
 
+// the last entry of each list, so that symbols are appended in place
+static symbolEntry *u_end = END_OF_LIST;
+static symbolEntry *d_end = END_OF_LIST;
+
+// every name seen, each keeps its entries in U and D so that they are
+// found without searching the lists
+static symbolTable *symbol_table = 0;
+
+// threads that intern names as files are read, 0 for one per processor
+#define MAX_THREADS 64
+static int thread_count = 0;
+
+// file the symbols being processed come from, recorded in D list entries
+static char *cur_source = 0;
+
+// suffix given to the next renamed local symbol
+static int local_n = 0;
+
+// while an archive member is applied speculatively its changes are logged,
+// entries after u_tail and d_tail were appended by it
+static bool speculating = false;
+static undoEntry *undo_log = 0;
+static int undo_count = 0;
+static int undo_capacity = 0;
+static symbolEntry *u_tail = END_OF_LIST;
+static symbolEntry *d_tail = END_OF_LIST;
+static int saved_local_n = 0;
+
+// where to write the defined symbol index, if anywhere
+static char *index_file = 0;
+
+// backend that reads symbols and how many files it is given at a time
+static symbolSource *source = &nativeSource;
+static int batch_size = 256;
+
+// read archives in place instead of extracting them, with at most
+// mem_budget bytes of each member in memory at once
+static bool stream_mode = false;
+static uint64_t mem_budget = 64 << 20;
+
+// print archive and run statistics to stderr
+static bool show_stats = false;
+
+// object files waiting to be read as one batch
+static char **pending = 0;
+static int pending_count = 0;
+static int pending_capacity = 0;
+
+// response files being read, one inside another
+#define MAX_RESPONSE_DEPTH 16
+static int response_depth = 0;
+
+// archives loaded so far, by content
+static archiveMembers **archives = 0;
+static int archive_count = 0;
+
+static int parseOptions(int argc, char *argv[]);
+static bool handleOption(char *arg);
+static void handleArgument(char *arg);
+static void handleResponseArgument(char *arg);
+static void handleInput(char *filename);
 static bool isObjectFile(char *filename);
 static bool isArchive(char *filename);
 static void handleObjectFile(char *filename);
+static void flushObjectFiles();
 static void handleArchive(char *filename);
-static bool processFile(char *filename, bool test_archive);
-static void processSymbol(char name[31], char type);
-static bool symbolCausesChange(char name[31], char type);
+static archiveMembers *loadArchive(char *filename, bool *reused);
+static archiveMembers *rememberArchive(archiveMembers *archive, bool hashed);
+static bool identifyFile(char *filename, uint64_t *hash, uint64_t *size);
+static void internSymbols(fileSymbols *files, int count);
+static void *internWorker(void *arg);
+static bool processSymbols(fileSymbols *symbols);
+static void processSymbol(symbolName *symbol, char type, symbolLookup *found);
+static bool symbolChanges(symbolLookup *found, char type);
+static void addUndefined(symbolName *symbol);
+static void addDefined(symbolName *symbol, char type);
+static void addLocal(char name[31], char type);
+static void linkDefined(symbolName *symbol, symbolEntry *entry);
+static void removeUndefined(symbolName *symbol);
+static void redefineSymbol(symbolName *symbol, char type);
+static void reportMultipleDefinition(char name[31]);
+static void beginMember();
+static void commitMember();
+static void rollbackMember();
+static undoEntry *logUndo(char kind);
 static void printUndefinedErrors();
 static void printDefinedList();
+static void writeIndex();
+static void printStats();
 static void displayErrorAndExit(char *message);
 static void systemCommand(char *command);
 
 int main(int argc, char *argv[])
 {
-    int i, istat; 
-    struct stat stFileInfo;
+    int i;
 
+    argc = parseOptions(argc, argv);
     if (argc <= 1)
     {
        printf("resolve: no input files\n");
        exit(1);
     }
+
+    if (thread_count == 0)
+    {
+        thread_count = (int) sysconf(_SC_NPROCESSORS_ONLN);
+        if (thread_count < 1)
+            thread_count = 1;
+        if (thread_count > MAX_THREADS)
+            thread_count = MAX_THREADS;
+    }
+    symbol_table = createSymbolTable();
+
     for (i = 1; i < argc; i++)
+        handleArgument(argv[i]);
+    flushObjectFiles();
+
+    perfBegin("output");
+    traceBegin("output", "undefined errors");
+    printUndefinedErrors();
+    traceEnd("output", "undefined errors");
+
+    traceBegin("output", "defined list");
+    printDefinedList();
+    traceEnd("output", "defined list");
+
+    traceBegin("output", "index");
+    writeIndex();
+    traceEnd("output", "index");
+    perfEnd();
+
+    printStats();
+    perfReport();
+
+    // the cache holds every record read, including those of remembered
+    // archives, so it goes last
+    freeSymbolCache();
+}
+
+/*
+ * function:    parseOptions
+ * description: handles the command line options and moves the input files
+ *              up to take their place
+ * params:
+ *      argc    the argument count
+ *      argv    the arguments
+ * returns:     the argument count without the options
+ */
+int parseOptions(int argc, char *argv[])
+{
+    int i, n = 1;
+
+    for (i = 1; i < argc; i++)
+        if (!handleOption(argv[i]))
+            argv[n++] = argv[i];
+
+    argv[n] = NULL;
+    return n;
+}
+
+/*
+ * function:    handleOption
+ * description: handles a command line option, options are:
+ *              --index=FILE    write the defined symbols to an index
+ *                              that symbolQuery can read
+ *              --trace=FILE    write a trace event timeline of the run
+ *              --backend=NAME  read symbols with the native ELF reader,
+ *                              the default, or with nm
+ *              --batch=N       hand at most N files to the backend at once
+ *              --stats         print members pulled and passes for each
+ *                              archive, and the run's time and memory
+ *              --perf-counters print cycles, instructions, cache misses
+ *                              and branch misses for each phase
+ *              --threads=N     intern names with N worker threads
+ *              --stream        read archives in place, member by member
+ *              --mem-budget=N  most bytes of a member to hold at once when
+ *                              streaming, with an optional K, M or G suffix
+ * params:
+ *      arg     the command line argument
+ * returns:     true if arg was an option, false if it is an input file
+ */
+bool handleOption(char *arg)
+{
+    if (strncmp(arg, "--index=", 8) == 0)
+    {
+        index_file = &arg[8];
+        return true;
+    }
+
+    if (strncmp(arg, "--trace=", 8) == 0)
+    {
+        if (!traceOpen(&arg[8]))
+            displayErrorAndExit("unable to start trace");
+        return true;
+    }
+
+    if (strncmp(arg, "--backend=", 10) == 0)
+    {
+        source = findSymbolSource(&arg[10]);
+        if (source == 0)
+            displayErrorAndExit("unknown backend, use native or nm");
+        return true;
+    }
+
+    if (strncmp(arg, "--batch=", 8) == 0)
+    {
+        batch_size = atoi(&arg[8]);
+        if (batch_size < 1)
+            displayErrorAndExit("batch size must be at least 1");
+        return true;
+    }
+
+    if (strncmp(arg, "--threads=", 10) == 0)
+    {
+        thread_count = atoi(&arg[10]);
+        if (thread_count < 1 || thread_count > MAX_THREADS)
+            displayErrorAndExit("threads must be from 1 to 64");
+        return true;
+    }
+
+    if (strcmp(arg, "--stats") == 0)
+    {
+        show_stats = true;
+        return true;
+    }
+
+    if (strcmp(arg, "--stream") == 0)
+    {
+        stream_mode = true;
+        return true;
+    }
+
+    if (strncmp(arg, "--mem-budget=", 13) == 0)
+    {
+        char *end;
+        int shift = 0;
+
+        mem_budget = strtoull(&arg[13], &end, 10);
+        if (*end == 'K' || *end == 'k')
+            shift = 10;
+        else if (*end == 'M' || *end == 'm')
+            shift = 20;
+        else if (*end == 'G' || *end == 'g')
+            shift = 30;
+        mem_budget <<= shift;
+
+        // nothing may follow the one suffix, and there must be digits
+        if (end == &arg[13] || end[shift > 0] != '\0')
+            displayErrorAndExit("memory budget must be a number of bytes, "
+                "optionally followed by K, M or G");
+        if (mem_budget < 4096)
+            displayErrorAndExit("memory budget must be at least 4096 bytes");
+        return true;
+    }
+
+    // a run without counters still resolves, perfReport says why
+    if (strcmp(arg, "--perf-counters") == 0)
+    {
+        perfOpen();
+        return true;
+    }
+
+    return false;
+}
+
+/*
+ * function:    handleArgument
+ * description: handle an input named on the command line or in a response
+ *              file, reading the inputs in @file response files and
+ *              --inputs-from lists in its place
+ * params:
+ *      arg: the argument
+ * returns:     void
+ */
+void handleArgument(char *arg)
+{
+    bool found;
+
+    // inputs already queued are read while waiting for more of the file
+    if (arg[0] == '@')
+    {
+        if (response_depth == MAX_RESPONSE_DEPTH)
+            displayErrorAndExit("response files nested too deeply");
+        response_depth++;
+        found = readResponseFile(&arg[1], handleResponseArgument,
+            flushObjectFiles);
+        response_depth--;
+
+        // like GNU tools, an @ argument that is not a readable file is
+        // taken as a file name
+        if (!found)
+            handleInput(arg);
+        return;
+    }
+
+    if (strncmp(arg, "--inputs-from=", 14) == 0)
     {
-        istat = stat(argv[i], &stFileInfo);
-        //if istat is 0 then file exists
-        if (istat == 0)
+        if (!readInputList(&arg[14], handleInput, flushObjectFiles))
         {
-            if (!isObjectFile(argv[i]) && !isArchive(argv[i]))
+            flushObjectFiles();
+            printf("%s: file not found\n", &arg[14]);
+        }
+        return;
+    }
+
+    handleInput(arg);
+}
+
+/*
+ * function:    handleResponseArgument
+ * description: handle an argument read from a response file, options take
+ *              effect from where they appear
+ * params:
+ *      arg: the argument, kept for the rest of the run
+ * returns:     void
+ */
+void handleResponseArgument(char *arg)
+{
+    if (!handleOption(arg))
+        handleArgument(arg);
+}
+
+/*
+ * function:    handleInput
+ * description: resolve an object file or archive, or report why it cannot
+ *              be
+ * params:
+ *      filename: the file's path, kept for the rest of the run
+ * returns:     void
+ */
+void handleInput(char *filename)
+{
+    int istat; 
+    struct stat stFileInfo;
+
+    istat = stat(filename, &stFileInfo);
+    //if istat is 0 then file exists
+    if (istat == 0)
+    {
+        if (!isObjectFile(filename) && !isArchive(filename))
+        {
+            flushObjectFiles();
+            printf("%s: file not recognized\n", filename);
+        } else {
+            if (isArchive(filename))
             {
-                printf("%s: file not recognized\n", argv[i]);
-            } else {
-                if (isArchive(argv[i])) handleArchive(argv[i]);
-                if (isObjectFile(argv[i])) handleObjectFile(argv[i]);
+                flushObjectFiles();
+                traceBegin("input", filename);
+                handleArchive(filename);
+                traceEnd("input", filename);
             }
-        } else {
-            printf("%s: file not found\n", argv[i]);
+            if (isObjectFile(filename)) handleObjectFile(filename);
         }
+    } else {
+        flushObjectFiles();
+        printf("%s: file not found\n", filename);
     }
-    printUndefinedErrors();
-    printDefinedList();
 }
 
 /*
  * function:    handleObjectFile
- * description: handles processing an object file
+ * description: handles processing an object file, object files are queued
+ *              so that a run of them can be read as one batch
  * params:
  *      filename    the object file's relative path
  * returns:     void
  */
 void handleObjectFile(char *filename)
 {
-    processFile(filename, false);
+    if (pending_count == pending_capacity)
+    {
+        pending_capacity = pending_capacity == 0 ? batch_size : pending_capacity * 2;
+        pending = (char**) realloc(pending, pending_capacity * sizeof(char*));
+        if (pending == NULL) displayErrorAndExit("malloc failed");
+    }
+
+    pending[pending_count++] = filename;
+    if (pending_count >= batch_size)
+        flushObjectFiles();
+}
+
+/*
+ * function:    flushObjectFiles
+ * description: read the queued object files and process them in order
+ * returns:     void
+ */
+void flushObjectFiles()
+{
+    fileSymbols *symbols;
+    int i;
+
+    if (pending_count == 0)
+        return;
+
+    symbols = (fileSymbols*) malloc(pending_count * sizeof(fileSymbols));
+    if (symbols == NULL) displayErrorAndExit("malloc failed");
+
+    perfBegin("object ingest");
+
+    traceBegin("read", "object files");
+    if (!readFileSymbols(source, pending, pending_count, batch_size, symbols))
+        displayErrorAndExit("unable to read symbols");
+    traceEnd("read", "object files");
+
+    traceBegin("intern", "object files");
+    internSymbols(symbols, pending_count);
+    traceEnd("intern", "object files");
+
+    for (i = 0; i < pending_count; i++)
+    {
+        traceBegin("input", pending[i]);
+        cur_source = pending[i];
+        processSymbols(&symbols[i]);
+        freeFileSymbols(&symbols[i]);
+        traceEnd("input", pending[i]);
+    }
+
+    perfEnd();
+
+    free(symbols);
+    pending_count = 0;
 }
 
 /*
@@ -96,44 +566,238 @@ void handleObjectFile(char *filename)
  */
 void handleArchive(char *filename)
 {
-    char command[150];
-    char obj_name[80];
-    char *buffer;
+    char pass_name[TRACE_NAME_LEN];
+    archiveMembers *archive;
+    char *base_name;
     bool changes = true;
-    FILE *fp;
+    bool changed, reused;
+    int i, pass = 0, pulled = 0;
 
-    // use .tmp/ prefix for extracted object file names
-    strcpy(obj_name, ".tmp/");
-    buffer = &obj_name[5];
+    perfBegin("archive load");
+    archive = loadArchive(filename, &reused);
+    if (!reused)
+    {
+        traceBegin("intern", filename);
+        internSymbols(archive->symbols, archive->count);
+        traceEnd("intern", filename);
+    }
+    perfEnd();
 
-    // remove .tmp/ if it exists and recreate it, ensuring that it is empty
-    // then, copy in the archive file, extract it, and remove the copied file
-    sprintf(command, "rm -r -f .tmp; mkdir .tmp; cp %s .tmp/__a; cd .tmp; ar -x __a; rm -f __a;", filename);
-    systemCommand(command);
+    base_name = strrchr(filename, '/');
+    snprintf(pass_name, sizeof(pass_name), "archive %s",
+        base_name == NULL ? filename : base_name + 1);
+    perfBegin(pass_name);
 
     // continued processing extracted object files until their symbols no
     // long cause changes
     while (changes)
     {
         changes = false;
-        fp = popen("cd .tmp; ls -1", "r");
-        if (fp == NULL) displayErrorAndExit("popen failed");
+        snprintf(pass_name, sizeof(pass_name), "%s pass %d", filename, ++pass);
+        traceBegin("archive", pass_name);
 
-        while (fgets(buffer, sizeof(buffer), fp))
+        for (i = 0; i < archive->count; i++)
         {
-            // if this object file will cause a change, process it like normal
-            if (processFile(obj_name, true))
+            // name pulled members archive(member), like ld does
+            cur_source = (char*) malloc(strlen(filename) + strlen(archive->names[i]) + 3);
+            if (cur_source == NULL) displayErrorAndExit("malloc failed");
+            sprintf(cur_source, "%s(%s)", filename, archive->names[i]);
+
+            // apply the member, then keep it if it resolved something and
+            // take it back otherwise
+            traceBegin("apply", archive->names[i]);
+            beginMember();
+            changed = processSymbols(&archive->symbols[i]);
+            traceEnd("apply", archive->names[i]);
+
+            if (changed)
             {
+                traceBegin("pull", archive->names[i]);
+                commitMember();
                 changes = true;
-                processFile(obj_name, false);
+                pulled++;
+                traceEnd("pull", archive->names[i]);
+            }
+            else
+            {
+                traceBegin("rollback", archive->names[i]);
+                rollbackMember();
+                free(cur_source);
+                cur_source = 0;
+                traceEnd("rollback", archive->names[i]);
             }
         }
 
-        pclose(fp);
+        traceEnd("archive", pass_name);
+    }
+    perfEnd();
+
+    if (show_stats)
+        fprintf(stderr, "stats: %s: %d members, %d pulled, %d passes%s\n",
+            filename, archive->count, pulled, pass, reused ? " (reused)" : "");
+}
+
+/*
+ * function:    loadArchive
+ * description: extract an archive and read its members' symbols, unless
+ *              an archive with the same content was loaded before
+ * params:
+ *      filename: the archive file's relative path
+ *      reused: set to true if an earlier load was reused
+ * returns:     the archive's members
+ */
+archiveMembers *loadArchive(char *filename, bool *reused)
+{
+    char command[150];
+    archiveMembers *archive;
+    char **paths = NULL;
+    char *line = NULL;
+    size_t line_size = 0;
+    bool hashed, streamed;
+    FILE *fp;
+    int i, len, capacity = 0;
+
+    archive = (archiveMembers*) calloc(1, sizeof(archiveMembers));
+    if (archive == NULL) displayErrorAndExit("malloc failed");
+
+    // hashing the content would mean reading all of it, which streaming
+    // is there to avoid
+    traceBegin("archive", "hash");
+    if (stream_mode)
+        hashed = identifyFile(filename, &archive->hash, &archive->size);
+    else
+        hashed = hashFile(filename, &archive->hash, &archive->size);
+    traceEnd("archive", "hash");
+
+    *reused = false;
+    for (i = 0; hashed && i < archive_count; i++)
+    {
+        if (archives[i]->hash == archive->hash && archives[i]->size == archive->size)
+        {
+            free(archive);
+            *reused = true;
+            return archives[i];
+        }
+    }
+
+    // archives the stream reader cannot handle, such as thin archives,
+    // are extracted as usual
+    if (stream_mode)
+    {
+        traceBegin("archive", "stream");
+        streamed = streamArchive(filename, source, mem_budget,
+            batch_size, &archive->count, &archive->names, &archive->symbols);
+        traceEnd("archive", "stream");
+        if (streamed)
+            return rememberArchive(archive, hashed);
+    }
+
+    // remove .tmp/ if it exists and recreate it, ensuring that it is empty
+    // then, copy in the archive file, extract it, and remove the copied file
+    sprintf(command, "rm -r -f .tmp; mkdir .tmp; cp %s .tmp/__a; cd .tmp; ar -x __a; rm -f __a;", filename);
+    traceBegin("archive", "extract");
+    systemCommand(command);
+    traceEnd("archive", "extract");
+
+    // list the extracted object files, use .tmp/ prefix for their paths,
+    // in byte order as --stream sorts them whatever the locale
+    fp = popen("cd .tmp; LC_ALL=C ls -1", "r");
+    if (fp == NULL) displayErrorAndExit("popen failed");
+
+    while (getline(&line, &line_size, fp) != -1)
+    {
+        len = strlen(line);
+        if (len > 0 && line[len - 1] == '\n')
+            line[--len] = '\0';
+
+        if (archive->count == capacity)
+        {
+            capacity = capacity == 0 ? 16 : capacity * 2;
+            archive->names = (char**) realloc(archive->names, capacity * sizeof(char*));
+            paths = (char**) realloc(paths, capacity * sizeof(char*));
+            if (archive->names == NULL || paths == NULL)
+                displayErrorAndExit("malloc failed");
+        }
+
+        archive->names[archive->count] = strdup(line);
+        paths[archive->count] = (char*) malloc(len + 6);
+        if (archive->names[archive->count] == NULL || paths[archive->count] == NULL)
+            displayErrorAndExit("malloc failed");
+        sprintf(paths[archive->count], ".tmp/%s", line);
+        archive->count++;
     }
+    free(line);
+    pclose(fp);
+
+    // every member's symbols are read once, up front, the passes only look
+    // at the records
+    archive->symbols = (fileSymbols*) malloc((archive->count + 1) * sizeof(fileSymbols));
+    if (archive->symbols == NULL) displayErrorAndExit("malloc failed");
+
+    traceBegin("archive", "read");
+    if (!readFileSymbols(source, paths, archive->count, batch_size, archive->symbols))
+        displayErrorAndExit("unable to read symbols");
+    traceEnd("archive", "read");
 
     // cleanup extracted files
+    traceBegin("archive", "cleanup");
     systemCommand("rm -r -f .tmp");
+    traceEnd("archive", "cleanup");
+
+    for (i = 0; i < archive->count; i++)
+        free(paths[i]);
+    free(paths);
+
+    return rememberArchive(archive, hashed);
+}
+
+/*
+ * function:    rememberArchive
+ * description: add a loaded archive to the ones kept for reuse
+ * params:
+ *      archive: the archive's members
+ *      hashed: false if the archive could not be fingerprinted, it is not
+ *              kept then
+ * returns:     the archive
+ */
+archiveMembers *rememberArchive(archiveMembers *archive, bool hashed)
+{
+    if (hashed)
+    {
+        archives = (archiveMembers**) realloc(archives,
+            (archive_count + 1) * sizeof(archiveMembers*));
+        if (archives == NULL) displayErrorAndExit("malloc failed");
+        archives[archive_count++] = archive;
+    }
+
+    return archive;
+}
+
+/*
+ * function:    identifyFile
+ * description: fingerprint a file by its device, inode, size and
+ *              modification time instead of its content
+ * params:
+ *      filename: the file's path
+ *      hash: set to the fingerprint
+ *      size: set to the file's size
+ * returns:     true on success, false if the file could not be examined
+ */
+bool identifyFile(char *filename, uint64_t *hash, uint64_t *size)
+{
+    struct stat st;
+    uint64_t key[4];
+
+    if (stat(filename, &st) != 0)
+        return false;
+
+    key[0] = st.st_dev;
+    key[1] = st.st_ino;
+    key[2] = st.st_mtim.tv_sec;
+    key[3] = st.st_mtim.tv_nsec;
+    *hash = hashContent(key, sizeof(key));
+    *size = st.st_size;
+    return true;
 }
 
 /* 
@@ -177,134 +841,446 @@ bool isArchive(char *filename)
 }
 
 /*
- * function:    processFile
- * description: process the symbols in an object file and either update
- *              the U and D lists or determine if this file would cause
- *              changes to U or D
+ * function:    internSymbols
+ * description: intern the names of the files' symbols, with worker
+ *              threads when there are several files
  * params:
- *      filename: the object file's relative path
- *      test_archive: if true then only test if this file causes changes
- *                    to U or D, otherwise process like normal
- * returns:     true if causes changes, false otherwise (or if test_archive
- *              is false)
+ *      files: the files' symbols
+ *      count: the number of files
+ * returns:     void
  */
-bool processFile(char *filename, bool test_archive)
+void internSymbols(fileSymbols *files, int count)
 {
-    char command[80];
-    char buffer[80];
-    char name[31];
-    char type;
-    char found;
-    bool caused_change = false;
-    FILE *fp;
+    pthread_t threads[MAX_THREADS];
+    internJob job;
+    int i, n;
 
-    // use nm to get this file's symbols
-    snprintf(command, sizeof(command), "nm %s", filename);
+    job.files = files;
+    job.count = count;
+    job.next = 0;
 
-    // open a pipe to proccess
-    fp = popen(command, "r");
-    if (fp == NULL) displayErrorAndExit("popen failed");
+    // this thread works too, so only the rest are started
+    n = thread_count < count ? thread_count : count;
+    for (i = 1; i < n; i++)
+        if (pthread_create(&threads[i], NULL, internWorker, &job) != 0)
+            break;
+    n = i;
+
+    internWorker(&job);
+
+    for (i = 1; i < n; i++)
+        pthread_join(threads[i], NULL);
+}
 
-    // go line by line of nm output
-    while (fgets(buffer, sizeof(buffer), fp))
+/*
+ * function:    internWorker
+ * description: intern the names of files from a job until it is done,
+ *              records already interned, shared by files with the same
+ *              content, are skipped
+ * params:
+ *      arg: the internJob
+ * returns:     NULL
+ */
+void *internWorker(void *arg)
+{
+    internJob *job = (internJob*) arg;
+    symbolRecord *records;
+    symbolName *symbol;
+    int i, j;
+
+    while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->count)
     {
-        if (sscanf(buffer, "%*x %c %s\n", &type, name) == 0)
-            sscanf(buffer, " %c %s\n", &type, name);
+        records = job->files[i].records;
+        for (j = 0; j < job->files[i].count; j++)
+        {
+            if (__atomic_load_n(&records[j].symbol, __ATOMIC_RELAXED) != NULL)
+                continue;
+            symbol = internSymbol(symbol_table, records[j].name);
+            __atomic_store_n(&records[j].symbol, symbol, __ATOMIC_RELAXED);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * function:    processSymbols
+ * description: process the symbols of an object file, updating the U and
+ *              D lists, the names must have been interned
+ * params:
+ *      symbols: the object file's symbols
+ * returns:     true if a symbol resolved an undefined symbol or changed a
+ *              COMMON one, what pulls an archive member in
+ */
+bool processSymbols(fileSymbols *symbols)
+{
+    symbolRecord *record;
+    symbolLookup found, before;
+    bool changed = false;
+    int i;
+
+    for (i = 0; i < symbols->count; i++)
+    {
+        record = &symbols->records[i];
+        processSymbol(record->symbol, record->type, &found);
 
-        if (!test_archive)
-            processSymbol(name, type);
-        else if (!caused_change)
-            caused_change = symbolCausesChange(name, type);
+        // only earlier symbols with the same name can have changed what the
+        // lists hold for it, and names are sorted so those come just
+        // before, test against the lists as they were before the first
+        if (i == 0 || record->symbol != symbols->records[i - 1].symbol)
+            before = found;
+        if (symbolChanges(&before, record->type))
+            changed = true;
     }
-    pclose(fp);
 
-    return test_archive && caused_change;
+    return changed;
 }
 
 /*
  * function:    processSymbol
  * description: process a symbol and change U and/or D lists as needed
  * params:
- *      name: the symbol's name
+ *      symbol: the symbol's interned name
  *      type: the symbol's type
+ *      found: set to what the lists held for the name beforehand
  * returns:     void
  */
-void processSymbol(char name[31], char type)
+void processSymbol(symbolName *symbol, char type, symbolLookup *found)
 {
-    char d_type = ' ';
-    char u_type = ' ';
     char local_name[31];
 
-    static int local_n = 0;
+    // a name is never in both lists, the D type that counts is that of
+    // the last entry
+    int in_u = symbol->undefined != END_OF_LIST;
+    int in_d = symbol->defined_count;
+    char d_type = in_d ? symbol->last_defined->type : ' ';
 
-    int in_d = findSymbol(d_list, name, &d_type);
-    int in_u = findSymbol(u_list, name, &u_type);
+    found->in_u = in_u;
+    found->in_d = in_d;
+    found->d_type = d_type;
 
     switch (type)
     {
     case 'U':
         if (!in_d && !in_u)
-            u_list = insertSymbol(u_list, name, type);
+            addUndefined(symbol);
         break;
     case 'T':
     case 'D':
         if (in_d)
         {
             if (d_type == 'T' || d_type == 'D')
-                printf(": multiple definition of %s\n", name);
+                reportMultipleDefinition(symbol->name);
             if (d_type == 'C')
-                updateSymbol(d_list, name, type);
+                redefineSymbol(symbol, type);
         }
         else if (in_u)
         {
-            u_list = removeSymbol(u_list, name);
-            d_list = insertSymbol(d_list, name, type);
+            removeUndefined(symbol);
+            addDefined(symbol, type);
         }
         else if (!in_d)
         {
-            d_list = insertSymbol(d_list, name, type);
+            addDefined(symbol, type);
         }
         break;
     case 'C':
         if (!in_d)
         {
-            d_list = insertSymbol(d_list, name, type);
+            addDefined(symbol, type);
         }
         if (in_u)
         {
-            u_list = removeSymbol(u_list, name);
+            removeUndefined(symbol);
         }
         break;
     case 'b':
     case 'd':
-        sprintf(local_name, "%s.%d", name, local_n);
-        d_list = insertSymbol(d_list, local_name, type);
+        // names are capped at 30 characters, the suffix is cut to fit and
+        // may be cut off entirely
+        snprintf(local_name, sizeof(local_name), "%s.%d", symbol->name, local_n);
         local_n++;
+        if (strcmp(local_name, symbol->name) == 0)
+            addDefined(symbol, type);
+        else
+            addLocal(local_name, type);
         break;
     }
 }
 
 /*
- * function:    symbolCausesChanges
- * description: test if a symbol would change U or D lists
+ * function:    symbolChanges
+ * description: test if a symbol changes U or D lists
  * params:
- *      name: the symbol's name
- *      type: the symbol's name
+ *      found: what the lists held for the symbol's name
+ *      type: the symbol's type
  * returns:     true or false
  */
-bool symbolCausesChange(char name[31], char type)
+bool symbolChanges(symbolLookup *found, char type)
 {
-    char found;
-
     // strong globals can change undefined symbols of the same name
-    if (findSymbol(u_list, name, &found))
+    if (found->in_u)
         return type == 'D' || type == 'T';
 
     // any symbol can change COMMON symbols
-    if (findSymbol(d_list, name, &found))
-        return found == 'C';
+    return found->in_d && found->d_type == 'C';
+}
 
-    return false;
+/*
+ * function:    addUndefined
+ * description: append a symbol to the U list
+ * params:
+ *      symbol: the symbol's interned name
+ * returns:     void
+ */
+void addUndefined(symbolName *symbol)
+{
+    u_list = appendSymbolFrom(u_list, &u_end, symbol->name, 'U', 0);
+    symbol->undefined = u_end;
+
+    if (speculating)
+        logUndo('a')->symbol = symbol;
+}
+
+/*
+ * function:    addDefined
+ * description: append a symbol from cur_source to the D list
+ * params:
+ *      symbol: the symbol's interned name
+ *      type: the symbol's type
+ * returns:     void
+ */
+void addDefined(symbolName *symbol, char type)
+{
+    undoEntry *undo;
+
+    if (speculating)
+    {
+        undo = logUndo('d');
+        undo->symbol = symbol;
+        undo->prev = symbol->last_defined;
+    }
+
+    d_list = appendSymbolFrom(d_list, &d_end, symbol->name, type, cur_source);
+    linkDefined(symbol, d_end);
+}
+
+/*
+ * function:    addLocal
+ * description: append a renamed local symbol from cur_source to the D
+ *              list.  Its name is only interned once the entry is sure to
+ *              stay, so members that are rolled back leave nothing in the
+ *              table and take no shard locks
+ * params:
+ *      name: the local's new name
+ *      type: the symbol's type
+ * returns:     void
+ */
+void addLocal(char name[31], char type)
+{
+    d_list = appendSymbolFrom(d_list, &d_end, name, type, cur_source);
+
+    if (speculating)
+        logUndo('l')->entry = d_end;
+    else
+        linkDefined(internSymbol(symbol_table, name), d_end);
+}
+
+/*
+ * function:    linkDefined
+ * description: make an entry just appended to the D list the last of a
+ *              symbol's defined entries
+ * params:
+ *      symbol: the symbol's interned name
+ *      entry: the entry
+ * returns:     void
+ */
+void linkDefined(symbolName *symbol, symbolEntry *entry)
+{
+    if (symbol->defined_count++ == 0)
+        symbol->first_defined = entry;
+    symbol->last_defined = entry;
+}
+
+/*
+ * function:    removeUndefined
+ * description: remove a symbol from the U list, keeping the entry while a
+ *              member is being applied so it can be put back
+ * params:
+ *      symbol: the symbol's interned name
+ * returns:     void
+ */
+void removeUndefined(symbolName *symbol)
+{
+    undoEntry *undo;
+    symbolEntry *entry;
+    symbolEntry *prev;
+
+    u_list = detachSymbol(u_list, symbol->name, &entry, &prev);
+    if (entry == u_end)
+        u_end = prev;
+    symbol->undefined = END_OF_LIST;
+
+    if (!speculating)
+    {
+        free(entry);
+        return;
+    }
+
+    undo = logUndo('r');
+    undo->symbol = symbol;
+    undo->entry = entry;
+    undo->prev = prev;
+}
+
+/*
+ * function:    redefineSymbol
+ * description: give a symbol's first entry in the D list a new type from
+ *              cur_source, logging the old one while a member is being
+ *              applied
+ * params:
+ *      symbol: the symbol's interned name
+ *      type: the symbol's new type
+ * returns:     void
+ */
+void redefineSymbol(symbolName *symbol, char type)
+{
+    symbolEntry *entry = symbol->first_defined;
+    undoEntry *undo;
+
+    if (speculating)
+    {
+        undo = logUndo('u');
+        undo->entry = entry;
+        undo->type = entry->type;
+        undo->source = entry->source;
+    }
+
+    entry->type = type;
+    entry->source = cur_source;
+}
+
+/*
+ * function:    reportMultipleDefinition
+ * description: print a multiple definition error, or hold it back until
+ *              the member being applied is kept
+ * params:
+ *      name: the symbol's name, must outlive the member being applied
+ * returns:     void
+ */
+void reportMultipleDefinition(char name[31])
+{
+    if (!speculating)
+    {
+        printf(": multiple definition of %s\n", name);
+        return;
+    }
+
+    logUndo('m')->name = name;
+}
+
+/*
+ * function:    beginMember
+ * description: start applying an archive member speculatively, changes to
+ *              U and D are logged until commitMember or rollbackMember
+ * returns:     void
+ */
+void beginMember()
+{
+    speculating = true;
+    undo_count = 0;
+    u_tail = u_end;
+    d_tail = d_end;
+    saved_local_n = local_n;
+}
+
+/*
+ * function:    commitMember
+ * description: keep the changes of the member being applied and print the
+ *              errors it held back
+ * returns:     void
+ */
+void commitMember()
+{
+    int i;
+
+    for (i = 0; i < undo_count; i++)
+    {
+        if (undo_log[i].kind == 'm')
+            printf(": multiple definition of %s\n", undo_log[i].name);
+        else if (undo_log[i].kind == 'r')
+            free(undo_log[i].entry);
+        else if (undo_log[i].kind == 'l')
+            linkDefined(internSymbol(symbol_table, undo_log[i].entry->name),
+                undo_log[i].entry);
+    }
+
+    undo_count = 0;
+    speculating = false;
+}
+
+/*
+ * function:    rollbackMember
+ * description: undo the changes of the member being applied, newest first,
+ *              then drop the entries it appended
+ * returns:     void
+ */
+void rollbackMember()
+{
+    undoEntry *undo;
+    int i;
+
+    for (i = undo_count - 1; i >= 0; i--)
+    {
+        undo = &undo_log[i];
+        if (undo->kind == 'r')
+        {
+            u_list = attachSymbol(u_list, undo->entry, undo->prev);
+            undo->symbol->undefined = undo->entry;
+        }
+        else if (undo->kind == 'u')
+        {
+            undo->entry->type = undo->type;
+            undo->entry->source = undo->source;
+        }
+        else if (undo->kind == 'a')
+            undo->symbol->undefined = END_OF_LIST;
+        else if (undo->kind == 'd')
+        {
+            undo->symbol->last_defined = undo->prev;
+            if (--undo->symbol->defined_count == 0)
+                undo->symbol->first_defined = END_OF_LIST;
+        }
+    }
+
+    u_list = truncateSymbols(u_list, u_tail);
+    d_list = truncateSymbols(d_list, d_tail);
+    u_end = u_tail;
+    d_end = d_tail;
+    local_n = saved_local_n;
+
+    undo_count = 0;
+    speculating = false;
+}
+
+/*
+ * function:    logUndo
+ * description: add an entry to the undo log
+ * params:
+ *      kind: the kind of change
+ * returns:     the new entry
+ */
+undoEntry *logUndo(char kind)
+{
+    if (undo_count == undo_capacity)
+    {
+        undo_capacity = undo_capacity == 0 ? 64 : undo_capacity * 2;
+        undo_log = (undoEntry*) realloc(undo_log, undo_capacity * sizeof(undoEntry));
+        if (undo_log == NULL) displayErrorAndExit("malloc failed");
+    }
+
+    undo_log[undo_count].kind = kind;
+    return &undo_log[undo_count++];
 }
 
 /*
@@ -339,6 +1315,49 @@ void printDefinedList()
     printSymbols(d_list);
 }
 
+/*
+ * function:    writeIndex
+ * description: write the D list to the index file, if one was requested
+ * returns:     void
+ */
+void writeIndex()
+{
+    if (index_file != 0 && !writeSymbolIndex(d_list, index_file))
+        displayErrorAndExit("unable to write symbol index");
+}
+
+/*
+ * function:    printStats
+ * description: print the run's time and peak memory, if stats were asked
+ *              for, nm processes are counted separately as children
+ * returns:     void
+ */
+void printStats()
+{
+    struct rusage self, children;
+    int parsed, reused;
+
+    if (!show_stats)
+        return;
+
+    symbolCacheStats(&parsed, &reused);
+    fprintf(stderr, "stats: %d files parsed, %d reused by content\n",
+        parsed, reused);
+    fprintf(stderr, "stats: %lu names interned by %d threads\n",
+        symbolTableCount(symbol_table), thread_count);
+
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+    fprintf(stderr, "stats: user %ld.%06lds, sys %ld.%06lds, max rss %ldkB\n",
+        (long) self.ru_utime.tv_sec, (long) self.ru_utime.tv_usec,
+        (long) self.ru_stime.tv_sec, (long) self.ru_stime.tv_usec,
+        self.ru_maxrss);
+    fprintf(stderr, "stats: children user %ld.%06lds, sys %ld.%06lds, max rss %ldkB\n",
+        (long) children.ru_utime.tv_sec, (long) children.ru_utime.tv_usec,
+        (long) children.ru_stime.tv_sec, (long) children.ru_stime.tv_usec,
+        children.ru_maxrss);
+}
+
 /*
  * function:    displayErrorAndExit
  * description: displays an error message and exits
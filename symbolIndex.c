@@ -0,0 +1,444 @@
+#include "symbolIndex.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static uint64_t align8(uint64_t offset);
+static int compareEntries(const void *a, const void *b);
+static int compareSources(const void *a, const void *b);
+static uint32_t sourceId(char **sources, uint32_t count, char *source);
+static bool writePadded(FILE *fp, const void *data, uint64_t size);
+
+/*
+ * function:    writeSymbolIndex
+ * description: write the symbols in a list to an index file
+ * params:
+ *      list        the symbolList to write
+ *      filename    the path of the index file to create
+ * returns:     true on success, false otherwise
+ */
+bool writeSymbolIndex(symbolList list, char *filename)
+{
+    symbolIndexHeader header;
+    symbolEntry **entries;
+    symbolEntry *cur;
+    char **sources;
+    uint32_t count = 0, file_count = 0, hash_size = 1;
+    uint32_t block_count, i, j;
+    uint32_t *blocks, *source_ids, *file_offs;
+    unsigned char *dict, *types;
+    symbolIndexSlot *hash;
+    uint64_t dict_size = 0, names_size = 0;
+    bool ok = false;
+    FILE *fp;
+
+    for (cur = list; cur != END_OF_LIST; cur = cur->next)
+        count++;
+
+    // sorted entries give the dictionary order, sorted source pointers
+    // give each distinct file an id
+    entries = (symbolEntry**) malloc((count + 1) * sizeof(symbolEntry*));
+    sources = (char**) malloc((count + 1) * sizeof(char*));
+    for (i = 0, cur = list; cur != END_OF_LIST; cur = cur->next, i++)
+    {
+        entries[i] = cur;
+        if (cur->source != 0)
+            sources[file_count++] = cur->source;
+    }
+    qsort(entries, count, sizeof(symbolEntry*), compareEntries);
+    qsort(sources, file_count, sizeof(char*), compareSources);
+    for (i = 0, j = 0; i < file_count; i++)
+        if (j == 0 || sources[j - 1] != sources[i])
+            sources[j++] = sources[i];
+    file_count = j;
+
+    while (hash_size < count * 2)
+        hash_size <<= 1;
+
+    block_count = (count + SYMBOL_INDEX_BLOCK - 1) / SYMBOL_INDEX_BLOCK;
+    blocks = (uint32_t*) malloc((block_count + 1) * sizeof(uint32_t));
+    dict = (unsigned char*) malloc(count * 2 + count * sizeof(entries[0]->name) + 1);
+    hash = (symbolIndexSlot*) calloc(hash_size, sizeof(symbolIndexSlot));
+    types = (unsigned char*) malloc(count + 1);
+    source_ids = (uint32_t*) malloc((count + 1) * sizeof(uint32_t));
+    file_offs = (uint32_t*) malloc((file_count + 1) * sizeof(uint32_t));
+
+    if (entries == 0 || sources == 0 || blocks == 0 || dict == 0 ||
+        hash == 0 || types == 0 || source_ids == 0 || file_offs == 0)
+    {
+        perror("in symbolIndex - malloc unable to allocate space");
+        goto done;
+    }
+
+    // front code the sorted names
+    for (i = 0; i < count; i++)
+    {
+        const char *name = entries[i]->name;
+        size_t len = entries[i]->length;
+        uint64_t h = entries[i]->hash;
+        uint32_t slot;
+
+        if (i % SYMBOL_INDEX_BLOCK == 0)
+        {
+            blocks[i / SYMBOL_INDEX_BLOCK] = (uint32_t) dict_size;
+            dict[dict_size++] = (unsigned char) len;
+            memcpy(&dict[dict_size], name, len);
+            dict_size += len;
+        }
+        else
+        {
+            const char *prev = entries[i - 1]->name;
+            size_t shared = 0;
+
+            while (prev[shared] != '\0' && prev[shared] == name[shared])
+                shared++;
+            dict[dict_size++] = (unsigned char) shared;
+            dict[dict_size++] = (unsigned char) (len - shared);
+            memcpy(&dict[dict_size], name + shared, len - shared);
+            dict_size += len - shared;
+        }
+
+        types[i] = (unsigned char) entries[i]->type;
+        source_ids[i] = entries[i]->source == 0 ? SYMBOL_INDEX_NO_SOURCE :
+            sourceId(sources, file_count, entries[i]->source);
+
+        // linear probing, the table is at most half full
+        slot = (uint32_t) h & (hash_size - 1);
+        while (hash[slot].id != 0)
+            slot = (slot + 1) & (hash_size - 1);
+        hash[slot].tag = (uint32_t) (h >> 32);
+        hash[slot].id = i + 1;
+    }
+
+    for (i = 0; i < file_count; i++)
+    {
+        file_offs[i] = (uint32_t) names_size;
+        names_size += strlen(sources[i]) + 1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SYMBOL_INDEX_MAGIC, sizeof(header.magic));
+    header.count = count;
+    header.block_size = SYMBOL_INDEX_BLOCK;
+    header.hash_size = hash_size;
+    header.file_count = file_count;
+    header.block_off = align8(sizeof(header));
+    header.dict_off = align8(header.block_off + block_count * sizeof(uint32_t));
+    header.hash_off = align8(header.dict_off + dict_size);
+    header.type_off = align8(header.hash_off +
+        (uint64_t) hash_size * sizeof(symbolIndexSlot));
+    header.source_off = align8(header.type_off + count);
+    header.file_off = align8(header.source_off + count * sizeof(uint32_t));
+
+    fp = fopen(filename, "wb");
+    if (fp == NULL)
+    {
+        perror(filename);
+        goto done;
+    }
+
+    ok = writePadded(fp, &header, sizeof(header)) &&
+        writePadded(fp, blocks, block_count * sizeof(uint32_t)) &&
+        writePadded(fp, dict, dict_size) &&
+        writePadded(fp, hash, (uint64_t) hash_size * sizeof(symbolIndexSlot)) &&
+        writePadded(fp, types, count) &&
+        writePadded(fp, source_ids, count * sizeof(uint32_t)) &&
+        fwrite(file_offs, sizeof(uint32_t), file_count, fp) == file_count;
+
+    for (i = 0; ok && i < file_count; i++)
+        ok = fwrite(sources[i], 1, strlen(sources[i]) + 1, fp) ==
+            strlen(sources[i]) + 1;
+
+    if (fclose(fp) != 0)
+        ok = false;
+    if (!ok)
+        perror(filename);
+
+done:
+    free(entries);
+    free(sources);
+    free(blocks);
+    free(dict);
+    free(hash);
+    free(types);
+    free(source_ids);
+    free(file_offs);
+    return ok;
+}
+
+/*
+ * function:    openSymbolIndex
+ * description: map an index file and check that its sections lie inside
+ *              the mapping, entries are checked as they are decoded
+ * params:
+ *      index       the index to initialize
+ *      filename    the path of the index file
+ * returns:     true on success, false otherwise
+ */
+bool openSymbolIndex(symbolIndex *index, char *filename)
+{
+    struct stat st;
+    const symbolIndexHeader *h;
+    uint64_t size, block_count, names_off;
+    void *base;
+    int fd;
+
+    memset(index, 0, sizeof(*index));
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        perror(filename);
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    if ((uint64_t) st.st_size < sizeof(symbolIndexHeader))
+    {
+        fprintf(stderr, "%s: not a symbol index\n", filename);
+        close(fd);
+        return false;
+    }
+
+    size = st.st_size;
+    base = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        perror(filename);
+        return false;
+    }
+
+    // reject anything whose sections would point outside the mapping, the
+    // hash table must have empty slots for a probe to stop at, and the file
+    // names must end in a nul before the end of the mapping
+    h = (const symbolIndexHeader*) base;
+    block_count = (h->count + SYMBOL_INDEX_BLOCK - 1) / SYMBOL_INDEX_BLOCK;
+    names_off = h->file_off + (uint64_t) h->file_count * sizeof(uint32_t);
+    if (memcmp(h->magic, SYMBOL_INDEX_MAGIC, sizeof(h->magic)) != 0 ||
+        h->block_size != SYMBOL_INDEX_BLOCK ||
+        h->hash_size == 0 || (h->hash_size & (h->hash_size - 1)) != 0 ||
+        h->hash_size < 2 * (uint64_t) h->count ||
+        h->block_off > size || h->dict_off > size || h->hash_off > size ||
+        h->type_off > size || h->source_off > size || h->file_off > size ||
+        ((h->block_off | h->hash_off | h->source_off | h->file_off) & 7) != 0 ||
+        h->block_off < sizeof(symbolIndexHeader) ||
+        h->block_off + block_count * sizeof(uint32_t) > h->dict_off ||
+        h->dict_off > h->hash_off ||
+        h->hash_off + (uint64_t) h->hash_size * sizeof(symbolIndexSlot) > h->type_off ||
+        h->type_off + h->count > h->source_off ||
+        h->source_off + (uint64_t) h->count * sizeof(uint32_t) > h->file_off ||
+        names_off > size ||
+        (h->file_count > 0 && (names_off == size ||
+            ((const char*) base)[size - 1] != '\0')))
+    {
+        fprintf(stderr, "%s: not a symbol index\n", filename);
+        munmap(base, size);
+        return false;
+    }
+
+    index->base = (const unsigned char*) base;
+    index->size = size;
+    index->header = h;
+    index->blocks = (const uint32_t*) (index->base + h->block_off);
+    index->dict = index->base + h->dict_off;
+    index->hash = (const symbolIndexSlot*) (index->base + h->hash_off);
+    index->types = index->base + h->type_off;
+    index->sources = (const uint32_t*) (index->base + h->source_off);
+    index->files = (const uint32_t*) (index->base + h->file_off);
+    return true;
+}
+
+/*
+ * function:    lookupSymbolIndex
+ * description: look up a symbol by name
+ * params:
+ *      index   an open index
+ *      name    the symbol name to look for
+ *      type    set to the symbol's type when found
+ *      source  set to the file the symbol came from when found, or 0 if
+ *              the file is not known
+ * returns:     true if found, false otherwise, index->corrupt is set when
+ *              the search met an entry that does not decode
+ */
+bool lookupSymbolIndex(symbolIndex *index, char *name, char *type,
+    const char **source)
+{
+    uint64_t h = symbolNameHash(name, strlen(name));
+    uint32_t mask = index->header->hash_size - 1;
+    uint32_t slot = (uint32_t) h & mask;
+    uint32_t probes;
+    char found[256];
+
+    // the table is at most half full, but a damaged one may not be
+    for (probes = 0; probes <= mask && index->hash[slot].id != 0; probes++)
+    {
+        if (index->hash[slot].tag == (uint32_t) (h >> 32))
+        {
+            if (!symbolIndexEntry(index, index->hash[slot].id - 1, found,
+                type, source))
+            {
+                index->corrupt = true;
+                return false;
+            }
+            if (strcmp(found, name) == 0)
+                return true;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return false;
+}
+
+/*
+ * function:    symbolIndexEntry
+ * description: decode the symbol with the given sorted rank
+ * params:
+ *      index   an open index
+ *      rank    the rank, from 0 to count - 1
+ *      name    buffer of at least 256 bytes that gets the name
+ *      type    set to the symbol's type
+ *      source  set to the file the symbol came from, or 0
+ * returns:     true on success, false if the rank is out of range or the
+ *              entry's bytes do not decode to a name inside the dictionary
+ */
+bool symbolIndexEntry(symbolIndex *index, uint32_t rank, char *name,
+    char *type, const char **source)
+{
+    const symbolIndexHeader *h = index->header;
+    uint64_t dict_size = h->hash_off - h->dict_off;
+    uint64_t names_off = h->file_off + (uint64_t) h->file_count * sizeof(uint32_t);
+    uint64_t pos;
+    uint32_t i, shared, suffix, len;
+    uint32_t file;
+
+    if (rank >= h->count)
+        return false;
+
+    // the block's first name is stored whole, the rest share a prefix
+    // with the name before them
+    pos = index->blocks[rank / SYMBOL_INDEX_BLOCK];
+    if (pos >= dict_size)
+        return false;
+    len = index->dict[pos++];
+    if (pos + len > dict_size)
+        return false;
+    memcpy(name, index->dict + pos, len);
+    pos += len;
+    for (i = 0; i < rank % SYMBOL_INDEX_BLOCK; i++)
+    {
+        if (pos + 2 > dict_size)
+            return false;
+        shared = index->dict[pos];
+        suffix = index->dict[pos + 1];
+        pos += 2;
+        if (shared > len || shared + suffix >= 256 || pos + suffix > dict_size)
+            return false;
+        memcpy(name + shared, index->dict + pos, suffix);
+        pos += suffix;
+        len = shared + suffix;
+    }
+    name[len] = '\0';
+
+    *type = (char) index->types[rank];
+
+    // the string area ends in a nul, so any offset inside it is a string
+    file = index->sources[rank];
+    if (file == SYMBOL_INDEX_NO_SOURCE)
+        *source = 0;
+    else if (file >= h->file_count || index->files[file] >= index->size - names_off)
+        return false;
+    else
+        *source = (const char*) (index->base + names_off + index->files[file]);
+    return true;
+}
+
+/*
+ * function:    closeSymbolIndex
+ * description: unmap an index opened with openSymbolIndex
+ * params:
+ *      index   the index to close
+ * returns:     void
+ */
+void closeSymbolIndex(symbolIndex *index)
+{
+    if (index->base != 0)
+        munmap((void*) index->base, index->size);
+    memset(index, 0, sizeof(*index));
+}
+
+/*
+ * function:    align8
+ * description: round an offset up to a multiple of 8
+ * params:
+ *      offset  the offset to round
+ * returns:     the rounded offset
+ */
+uint64_t align8(uint64_t offset)
+{
+    return (offset + 7) & ~(uint64_t) 7;
+}
+
+/*
+ * function:    compareEntries
+ * description: qsort comparison of symbolEntry pointers by name
+ */
+int compareEntries(const void *a, const void *b)
+{
+    return strcmp((*(symbolEntry* const*) a)->name,
+        (*(symbolEntry* const*) b)->name);
+}
+
+/*
+ * function:    compareSources
+ * description: qsort comparison of source strings by address, entries
+ *              from one file share the same string
+ */
+int compareSources(const void *a, const void *b)
+{
+    char *x = *(char* const*) a;
+    char *y = *(char* const*) b;
+
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * function:    sourceId
+ * description: binary search the sorted distinct sources for a file
+ * params:
+ *      sources the sorted sources
+ *      count   number of sources
+ *      source  the source to look for
+ * returns:     the source's id
+ */
+uint32_t sourceId(char **sources, uint32_t count, char *source)
+{
+    char **found = (char**) bsearch(&source, sources, count, sizeof(char*),
+        compareSources);
+
+    return found == 0 ? SYMBOL_INDEX_NO_SOURCE : (uint32_t) (found - sources);
+}
+
+/*
+ * function:    writePadded
+ * description: write a section and pad the file to the next 8 byte boundary
+ * params:
+ *      fp      the file to write to
+ *      data    the section's bytes
+ *      size    the section's size
+ * returns:     true on success, false otherwise
+ */
+bool writePadded(FILE *fp, const void *data, uint64_t size)
+{
+    static const char zeros[8];
+    uint64_t pad = align8(size) - size;
+
+    if (size != 0 && fwrite(data, 1, size, fp) != size)
+        return false;
+    return pad == 0 || fwrite(zeros, 1, pad, fp) == pad;
+}
@@ -0,0 +1,131 @@
+#ifndef SYMBOLINDEX_H
+#define SYMBOLINDEX_H
+
+#include <stdint.h>
+#include "symbolList.h"
+#include "bool.h"
+
+/*
+ * On-disk layout of a symbol index, all integers are little endian and
+ * every section starts on an 8 byte boundary:
+ *
+ *      header          symbolIndexHeader
+ *      blocks          uint32_t[block count], offset of each block in dict
+ *      dict            front coded names sorted with strcmp, each block
+ *                      starts with a full name (len, bytes) followed by up to
+ *                      SYMBOL_INDEX_BLOCK - 1 names stored as (shared prefix
+ *                      len, suffix len, suffix bytes)
+ *      hash            symbolIndexSlot[hash size], open addressing table
+ *      types           uint8_t[count], symbol type by sorted rank
+ *      sources         uint32_t[count], file id by sorted rank
+ *      files           uint32_t[file count] offsets into the string area,
+ *                      followed by the nul terminated file names
+ */
+#define SYMBOL_INDEX_MAGIC "SYMIDX01"
+#define SYMBOL_INDEX_BLOCK 16
+#define SYMBOL_INDEX_NO_SOURCE 0xffffffffu
+
+typedef struct symbolIndexHeader
+{
+    char magic[8];
+    uint32_t count;
+    uint32_t block_size;
+    uint32_t hash_size;
+    uint32_t file_count;
+    uint64_t block_off;
+    uint64_t dict_off;
+    uint64_t hash_off;
+    uint64_t type_off;
+    uint64_t source_off;
+    uint64_t file_off;
+} symbolIndexHeader;
+
+/*
+ * a hash slot, id is the sorted rank plus one so that zero marks an empty
+ * slot and tag is the high half of the name hash
+ */
+typedef struct symbolIndexSlot
+{
+    uint32_t tag;
+    uint32_t id;
+} symbolIndexSlot;
+
+/*
+ * an index opened with openSymbolIndex, the file stays mapped until
+ * closeSymbolIndex is called
+ */
+typedef struct symbolIndex
+{
+    const unsigned char *base;
+    uint64_t size;
+    const symbolIndexHeader *header;
+    const uint32_t *blocks;
+    const unsigned char *dict;
+    const symbolIndexSlot *hash;
+    const unsigned char *types;
+    const uint32_t *sources;
+    const uint32_t *files;
+    bool corrupt;
+} symbolIndex;
+
+/*
+ * function:    writeSymbolIndex
+ * description: write the symbols in a list to an index file
+ * params:
+ *      list        the symbolList to write
+ *      filename    the path of the index file to create
+ * returns:     true on success, false otherwise
+ */
+bool writeSymbolIndex(symbolList list, char *filename);
+
+/*
+ * function:    openSymbolIndex
+ * description: map an index file and check that its sections lie inside
+ *              the mapping, entries are checked as they are decoded
+ * params:
+ *      index       the index to initialize
+ *      filename    the path of the index file
+ * returns:     true on success, false otherwise
+ */
+bool openSymbolIndex(symbolIndex *index, char *filename);
+
+/*
+ * function:    lookupSymbolIndex
+ * description: look up a symbol by name
+ * params:
+ *      index   an open index
+ *      name    the symbol name to look for
+ *      type    set to the symbol's type when found
+ *      source  set to the file the symbol came from when found, or 0 if
+ *              the file is not known
+ * returns:     true if found, false otherwise, index->corrupt is set when
+ *              the search met an entry that does not decode
+ */
+bool lookupSymbolIndex(symbolIndex *index, char *name, char *type,
+    const char **source);
+
+/*
+ * function:    symbolIndexEntry
+ * description: decode the symbol with the given sorted rank
+ * params:
+ *      index   an open index
+ *      rank    the rank, from 0 to count - 1
+ *      name    buffer of at least 256 bytes that gets the name
+ *      type    set to the symbol's type
+ *      source  set to the file the symbol came from, or 0
+ * returns:     true on success, false if the rank is out of range or the
+ *              entry's bytes do not decode to a name inside the dictionary
+ */
+bool symbolIndexEntry(symbolIndex *index, uint32_t rank, char *name,
+    char *type, const char **source);
+
+/*
+ * function:    closeSymbolIndex
+ * description: unmap an index opened with openSymbolIndex
+ * params:
+ *      index   the index to close
+ * returns:     void
+ */
+void closeSymbolIndex(symbolIndex *index);
+
+#endif
@@ -2,6 +2,36 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/*
+ * a name being looked for, padded like the names in entries, with its hash
+ * and length worked out once for the whole search
+ */
+typedef struct symbolKey
+{
+    char name[SYMBOL_NAME_SIZE] __attribute__((aligned(32)));
+    uint64_t hash;
+    unsigned char length;
+} symbolKey;
+
+static void makeKey(symbolKey *key, const char *name);
+static void setEntryName(symbolEntry *entry, const char *name);
+static int entryMatches(symbolEntry *entry, symbolKey *key);
+static symbolName *findInShard(symbolShard *shard, symbolKey *key);
+static void growShard(symbolShard *shard);
+static int namesEqualBytes(const char *a, const char *b);
+#if defined(__x86_64__) || defined(__i386__)
+static int namesEqualSse2(const char *a, const char *b);
+static int namesEqualAvx2(const char *a, const char *b);
+#endif
+static void pickCompareKernel();
+
+// compares two padded names, set for the processor before main runs
+static int (*namesEqual)(const char *a, const char *b) = namesEqualBytes;
+static const char *kernel_name = "bytes";
 
 /*
  * function:    insertSymbol
@@ -12,7 +42,25 @@
  *      type    the symbolEntry type
  * returns:     the new list
  */
-symbolList insertSymbol(symbolList list, char name[31], char type)
+symbolList insertSymbol(symbolList list, const char *name, char type)
+{
+    return insertSymbolFrom(list, name, type, 0);
+}
+
+/*
+ * function:    insertSymbolFrom
+ * description: create a new symbol that records the file it came from and
+ *              append to end of list
+ * params:
+ *      list    the symbolList to append to
+ *      name    the symbolEntry name
+ *      type    the symbolEntry type
+ *      source  the file the symbol came from, the string is not copied and
+ *              must outlive the list
+ * returns:     the new list
+ */
+symbolList insertSymbolFrom(symbolList list, const char *name, char type,
+    char *source)
 {
     // create new entry
     symbolEntry *new = (symbolEntry*) malloc(sizeof(symbolEntry));
@@ -25,8 +73,9 @@ symbolList insertSymbol(symbolList list, char name[31], char type)
     }
 
     // initialize new entry
-    strcpy(new->name, name);
+    setEntryName(new, name);
     new->type = type;
+    new->source = source;
     new->next = END_OF_LIST;
 
     symbolEntry *cur = list;
@@ -45,6 +94,48 @@ symbolList insertSymbol(symbolList list, char name[31], char type)
     return list;
 }
 
+/*
+ * function:    appendSymbolFrom
+ * description: create a new symbol that records the file it came from and
+ *              append it after the last entry, without walking the list
+ * params:
+ *      list    the symbolList to append to
+ *      last    the list's last entry, END_OF_LIST if it is empty, set to
+ *              the new entry
+ *      name    the symbolEntry name
+ *      type    the symbolEntry type
+ *      source  the file the symbol came from, not copied
+ * returns:     the new list
+ */
+symbolList appendSymbolFrom(symbolList list, symbolEntry **last,
+    const char *name, char type, char *source)
+{
+    // create new entry
+    symbolEntry *new = (symbolEntry*) malloc(sizeof(symbolEntry));
+
+    // exit on error
+    if (new == 0)
+    {
+        perror("in symbolList - malloc unable to allocate space");
+        exit(0);
+    }
+
+    // initialize new entry
+    setEntryName(new, name);
+    new->type = type;
+    new->source = source;
+    new->next = END_OF_LIST;
+
+    // special case when list is empty
+    if (*last == END_OF_LIST)
+        list = new;
+    else
+        (*last)->next = new;
+
+    *last = new;
+    return list;
+}
+
 /*
  * function:    updateSymbol
  * description: update a symbol in the list
@@ -54,18 +145,56 @@ symbolList insertSymbol(symbolList list, char name[31], char type)
  *      type    the symbolEntry type to update to
  * returns:     void
  */
-void updateSymbol(symbolList list, char name[31], char type)
+void updateSymbol(symbolList list, const char *name, char type)
+{
+    symbolEntry *cur = list;
+    symbolKey key;
+
+    makeKey(&key, name);
+
+    // traverse list
+    while (cur != END_OF_LIST)
+    {
+        // found symbol?
+        if (entryMatches(cur, &key))
+        {
+            // update entry and exit
+            cur->type = type;
+            return;
+        }
+
+        // symbol not found, keep going
+        cur = cur->next;
+    }
+}
+
+/*
+ * function:    updateSymbolFrom
+ * description: update a symbol in the list and the file it came from
+ * params:
+ *      list    the symbolList to update
+ *      name    the symbolEntry name to look for
+ *      type    the symbolEntry type to update to
+ *      source  the file the new type came from, not copied
+ * returns:     void
+ */
+void updateSymbolFrom(symbolList list, const char *name, char type,
+    char *source)
 {
     symbolEntry *cur = list;
+    symbolKey key;
+
+    makeKey(&key, name);
 
     // traverse list
     while (cur != END_OF_LIST)
     {
         // found symbol?
-        if (strcmp(cur->name, name) == 0)
+        if (entryMatches(cur, &key))
         {
             // update entry and exit
             cur->type = type;
+            cur->source = source;
             return;
         }
 
@@ -84,16 +213,19 @@ void updateSymbol(symbolList list, char name[31], char type)
  *              match found in the list
  * returns:     count of matches
  */
-int findSymbol(symbolList list, char name[31], char *type)
+int findSymbol(symbolList list, const char *name, char *type)
 {
     int count = 0;
     symbolEntry *cur = list;
+    symbolKey key;
+
+    makeKey(&key, name);
 
     // traverse list
     while (cur != END_OF_LIST)
     {
         // symbol found?
-        if (strcmp(cur->name, name) == 0)
+        if (entryMatches(cur, &key))
         {
             // add to count and record found type
             count++;
@@ -113,37 +245,138 @@ int findSymbol(symbolList list, char name[31], char *type)
  *      name    the symbolEntry name to remove
  * returns:     the new list
  */
-symbolList removeSymbol(symbolList list, char name[31])
+symbolList removeSymbol(symbolList list, const char *name)
+{
+    symbolEntry *entry;
+    symbolEntry *prev;
+
+    list = detachSymbol(list, name, &entry, &prev);
+    free(entry);
+
+    return list;
+}
+
+/*
+ * function:    lookupSymbol
+ * description: find the first symbolEntry with a name
+ * params:
+ *      list    the symbolList to search in
+ *      name    the symbolEntry name to search for
+ * returns:     the entry, or END_OF_LIST if there is none
+ */
+symbolEntry *lookupSymbol(symbolList list, const char *name)
 {
     symbolEntry *cur = list;
-    symbolEntry *next;
+    symbolKey key;
 
-    // empty list?
-    if (list == END_OF_LIST)
-        return END_OF_LIST;
+    makeKey(&key, name);
+
+    // traverse list
+    while (cur != END_OF_LIST && !entryMatches(cur, &key))
+        cur = cur->next;
+
+    return cur;
+}
+
+/*
+ * function:    detachSymbol
+ * description: unlink the first symbolEntry with a name from a list
+ *              without freeing it, so that attachSymbol can put it back
+ * params:
+ *      list    the symbolList to remove from
+ *      name    the symbolEntry name to remove
+ *      entry   set to the unlinked entry, or END_OF_LIST if none matched
+ *      prev    set to the entry that was before it, END_OF_LIST if it was
+ *              the head
+ * returns:     the new list
+ */
+symbolList detachSymbol(symbolList list, const char *name,
+    symbolEntry **entry, symbolEntry **prev)
+{
+    symbolEntry *cur = END_OF_LIST;
+    symbolEntry *next = list;
+    symbolKey key;
+
+    makeKey(&key, name);
+
+    // traverse list
+    while (next != END_OF_LIST && !entryMatches(next, &key))
+    {
+        cur = next;
+        next = cur->next;
+    }
+
+    *entry = next;
+    *prev = cur;
+
+    // not found?
+    if (next == END_OF_LIST)
+        return list;
 
     // special case when removing from head
-    if (strcmp(list->name, name) == 0)
+    if (cur == END_OF_LIST)
+        list = next->next;
+    else
+        cur->next = next->next;
+
+    next->next = END_OF_LIST;
+    return list;
+}
+
+/*
+ * function:    attachSymbol
+ * description: link an entry back into a list, the reverse of detachSymbol
+ * params:
+ *      list    the symbolList to add to
+ *      entry   the entry to link in
+ *      prev    the entry to link it after, END_OF_LIST for the head
+ * returns:     the new list
+ */
+symbolList attachSymbol(symbolList list, symbolEntry *entry,
+    symbolEntry *prev)
+{
+    if (prev == END_OF_LIST)
     {
-        free(cur);
-        return list->next;
+        entry->next = list;
+        return entry;
     }
 
-    next = cur->next;
+    entry->next = prev->next;
+    prev->next = entry;
+    return list;
+}
 
-    // traverse list
-    while (next != END_OF_LIST)
+/*
+ * function:    truncateSymbols
+ * description: free every entry after an entry
+ * params:
+ *      list    the symbolList to cut short
+ *      last    the entry to keep as the end of the list, END_OF_LIST to
+ *              free the whole list
+ * returns:     the new list
+ */
+symbolList truncateSymbols(symbolList list, symbolEntry *last)
+{
+    symbolEntry *cur;
+    symbolEntry *next;
+
+    if (last == END_OF_LIST)
+    {
+        cur = list;
+        list = END_OF_LIST;
+    }
+    else
+    {
+        cur = last->next;
+        last->next = END_OF_LIST;
+    }
+
+    // free the rest
+    while (cur != END_OF_LIST)
     {
-        // symbol found?
-        if (strcmp(next->name, name) == 0)
-        {
-            // remove from list and exit
-            cur->next = next->next;
-            free(next);
-            break;
-        }
-        cur = next;
         next = cur->next;
+        free(cur);
+        cur = next;
     }
 
     return list;
@@ -166,4 +399,397 @@ void printSymbols(symbolList list)
         printf("%-32s %c\n", cur->name, cur->type);
         cur = cur->next;
     }
-}
\ No newline at end of file
+}
+
+/*
+ * function:    createSymbolTable
+ * description: create an empty symbol table
+ * returns:     the new table
+ */
+symbolTable *createSymbolTable()
+{
+    symbolTable *table;
+    int i;
+
+    if (posix_memalign((void**) &table, 64, sizeof(symbolTable)) != 0)
+    {
+        perror("in symbolList - malloc unable to allocate space");
+        exit(0);
+    }
+
+    for (i = 0; i < SYMBOL_TABLE_SHARDS; i++)
+    {
+        pthread_mutex_init(&table->shards[i].lock, 0);
+        table->shards[i].buckets = 0;
+        table->shards[i].size = 0;
+        table->shards[i].count = 0;
+    }
+
+    return table;
+}
+
+/*
+ * function:    internSymbol
+ * description: find a name in the table, adding it if it is not there yet,
+ *              safe to call from several threads at once
+ * params:
+ *      table   the symbolTable
+ *      name    the name to intern
+ * returns:     the name's symbolName
+ */
+symbolName *internSymbol(symbolTable *table, const char *name)
+{
+    symbolKey key;
+    symbolShard *shard;
+    symbolName *cur;
+
+    makeKey(&key, name);
+    shard = &table->shards[key.hash >> 58];
+
+    pthread_mutex_lock(&shard->lock);
+
+    cur = findInShard(shard, &key);
+    if (cur == 0)
+    {
+        // keep chains short, at most one name per bucket on average
+        if (shard->count >= shard->size)
+            growShard(shard);
+
+        cur = (symbolName*) malloc(sizeof(symbolName));
+        if (cur == 0)
+        {
+            perror("in symbolList - malloc unable to allocate space");
+            exit(0);
+        }
+
+        memcpy(cur->name, key.name, SYMBOL_NAME_SIZE);
+        cur->hash = key.hash;
+        cur->undefined = END_OF_LIST;
+        cur->first_defined = END_OF_LIST;
+        cur->last_defined = END_OF_LIST;
+        cur->defined_count = 0;
+        cur->next = shard->buckets[key.hash & (shard->size - 1)];
+        shard->buckets[key.hash & (shard->size - 1)] = cur;
+        shard->count++;
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+    return cur;
+}
+
+/*
+ * function:    findInterned
+ * description: find a name in the table without adding it, safe to call
+ *              from several threads at once
+ * params:
+ *      table   the symbolTable
+ *      name    the name to look for
+ * returns:     the name's symbolName, or 0 if it was never interned
+ */
+symbolName *findInterned(symbolTable *table, const char *name)
+{
+    symbolKey key;
+    symbolShard *shard;
+    symbolName *found;
+
+    makeKey(&key, name);
+    shard = &table->shards[key.hash >> 58];
+
+    pthread_mutex_lock(&shard->lock);
+    found = findInShard(shard, &key);
+    pthread_mutex_unlock(&shard->lock);
+
+    return found;
+}
+
+/*
+ * function:    symbolTableCount
+ * description: count the names in a table
+ * params:
+ *      table   the symbolTable
+ * returns:     the number of names interned
+ */
+unsigned long symbolTableCount(symbolTable *table)
+{
+    unsigned long count = 0;
+    int i;
+
+    for (i = 0; i < SYMBOL_TABLE_SHARDS; i++)
+    {
+        pthread_mutex_lock(&table->shards[i].lock);
+        count += table->shards[i].count;
+        pthread_mutex_unlock(&table->shards[i].lock);
+    }
+
+    return count;
+}
+
+/*
+ * function:    freeSymbolTable
+ * description: free a table and its names, no other thread may be using it
+ * params:
+ *      table   the symbolTable
+ * returns:     void
+ */
+void freeSymbolTable(symbolTable *table)
+{
+    symbolName *cur, *next;
+    unsigned long j;
+    int i;
+
+    for (i = 0; i < SYMBOL_TABLE_SHARDS; i++)
+    {
+        for (j = 0; j < table->shards[i].size; j++)
+        {
+            for (cur = table->shards[i].buckets[j]; cur != 0; cur = next)
+            {
+                next = cur->next;
+                free(cur);
+            }
+        }
+        free(table->shards[i].buckets);
+        pthread_mutex_destroy(&table->shards[i].lock);
+    }
+
+    free(table);
+}
+
+/*
+ * function:    findInShard
+ * description: look a name up in a shard, the shard must be locked
+ * params:
+ *      shard   the shard the name's hash picks
+ *      key     the name
+ * returns:     the name's symbolName, or 0 if it is not there
+ */
+symbolName *findInShard(symbolShard *shard, symbolKey *key)
+{
+    symbolName *cur;
+
+    if (shard->size == 0)
+        return 0;
+
+    for (cur = shard->buckets[key->hash & (shard->size - 1)]; cur != 0; cur = cur->next)
+        if (cur->hash == key->hash && namesEqual(cur->name, key->name))
+            return cur;
+
+    return 0;
+}
+
+/*
+ * function:    growShard
+ * description: double the buckets of a shard, the shard must be locked
+ * params:
+ *      shard   the shard to grow
+ * returns:     void
+ */
+void growShard(symbolShard *shard)
+{
+    unsigned long size = shard->size == 0 ? 64 : shard->size * 2;
+    symbolName **buckets = (symbolName**) calloc(size, sizeof(symbolName*));
+    symbolName *cur, *next;
+    unsigned long i;
+
+    if (buckets == 0)
+    {
+        perror("in symbolList - malloc unable to allocate space");
+        exit(0);
+    }
+
+    for (i = 0; i < shard->size; i++)
+    {
+        for (cur = shard->buckets[i]; cur != 0; cur = next)
+        {
+            next = cur->next;
+            cur->next = buckets[cur->hash & (size - 1)];
+            buckets[cur->hash & (size - 1)] = cur;
+        }
+    }
+
+    free(shard->buckets);
+    shard->buckets = buckets;
+    shard->size = size;
+}
+
+/*
+ * function:    symbolCompareKernel
+ * description: name the kernel that compares names, picked for the
+ *              processor when the program starts
+ * returns:     "avx2", "sse2" or "bytes"
+ */
+const char *symbolCompareKernel()
+{
+    return kernel_name;
+}
+
+/*
+ * function:    useSymbolCompareKernel
+ * description: compare names with a given kernel instead, for benchmarks
+ * params:
+ *      name    the kernel, as symbolCompareKernel names it
+ * returns:     1 if the processor supports it, 0 otherwise
+ */
+int useSymbolCompareKernel(const char *name)
+{
+    if (strcmp(name, "bytes") == 0)
+    {
+        namesEqual = namesEqualBytes;
+        kernel_name = "bytes";
+        return 1;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2"))
+    {
+        namesEqual = namesEqualSse2;
+        kernel_name = "sse2";
+        return 1;
+    }
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2"))
+    {
+        namesEqual = namesEqualAvx2;
+        kernel_name = "avx2";
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+/*
+ * function:    symbolNamesEqual
+ * description: compare two names padded to SYMBOL_NAME_SIZE bytes with the
+ *              kernel in use, lookups only get this far once hash and
+ *              length match, so tests call it directly
+ * params:
+ *      a       the first name
+ *      b       the second name
+ * returns:     1 if they are the same, 0 otherwise
+ */
+int symbolNamesEqual(const char *a, const char *b)
+{
+    return namesEqual(a, b);
+}
+
+/*
+ * function:    makeKey
+ * description: pad a name and work out its hash and length for a search
+ * params:
+ *      key     the key to fill in
+ *      name    the name, cut to 31 characters
+ * returns:     void
+ */
+void makeKey(symbolKey *key, const char *name)
+{
+    key->length = strnlen(name, SYMBOL_NAME_SIZE - 1);
+    memset(key->name, 0, SYMBOL_NAME_SIZE);
+    memcpy(key->name, name, key->length);
+    key->hash = symbolNameHash(key->name, key->length);
+}
+
+/*
+ * function:    setEntryName
+ * description: give an entry its padded name, hash and length
+ * params:
+ *      entry   the entry
+ *      name    the name, cut to 31 characters
+ * returns:     void
+ */
+void setEntryName(symbolEntry *entry, const char *name)
+{
+    entry->length = strnlen(name, SYMBOL_NAME_SIZE - 1);
+    memset(entry->name, 0, SYMBOL_NAME_SIZE);
+    memcpy(entry->name, name, entry->length);
+    entry->hash = symbolNameHash(entry->name, entry->length);
+}
+
+/*
+ * function:    entryMatches
+ * description: test if an entry has the key's name, hash and length rule
+ *              out nearly every other name before the names are compared
+ * params:
+ *      entry   the entry
+ *      key     the name being looked for
+ * returns:     1 if the names are the same, 0 otherwise
+ */
+int entryMatches(symbolEntry *entry, symbolKey *key)
+{
+    return entry->hash == key->hash && entry->length == key->length &&
+        namesEqual(entry->name, key->name);
+}
+
+/*
+ * function:    symbolNameHash
+ * description: 64 bit FNV-1a hash of a symbol name, the hash entries,
+ *              interned names and symbol indexes all use
+ * params:
+ *      name    the name
+ *      length  its length
+ * returns:     the hash
+ */
+uint64_t symbolNameHash(const char *name, int length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    int i;
+
+    for (i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char) name[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/*
+ * function:    namesEqualBytes
+ * description: compare two padded names a byte at a time
+ * returns:     1 if they are the same, 0 otherwise
+ */
+int namesEqualBytes(const char *a, const char *b)
+{
+    return memcmp(a, b, SYMBOL_NAME_SIZE) == 0;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/*
+ * function:    namesEqualSse2
+ * description: compare two padded names as two 16 byte vectors
+ * returns:     1 if they are the same, 0 otherwise
+ */
+__attribute__((target("sse2")))
+int namesEqualSse2(const char *a, const char *b)
+{
+    __m128i lo = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) a),
+        _mm_loadu_si128((const __m128i*) b));
+    __m128i hi = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (a + 16)),
+        _mm_loadu_si128((const __m128i*) (b + 16)));
+
+    return _mm_movemask_epi8(_mm_and_si128(lo, hi)) == 0xffff;
+}
+
+/*
+ * function:    namesEqualAvx2
+ * description: compare two padded names as one 32 byte vector
+ * returns:     1 if they are the same, 0 otherwise
+ */
+__attribute__((target("avx2")))
+int namesEqualAvx2(const char *a, const char *b)
+{
+    __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) a),
+        _mm256_loadu_si256((const __m256i*) b));
+
+    return (unsigned int) _mm256_movemask_epi8(eq) == 0xffffffffu;
+}
+#endif
+
+/*
+ * function:    pickCompareKernel
+ * description: use the widest compare kernel the processor supports, run
+ *              before main so that threads never see it change
+ */
+__attribute__((constructor))
+void pickCompareKernel()
+{
+    if (!useSymbolCompareKernel("avx2") && !useSymbolCompareKernel("sse2"))
+        useSymbolCompareKernel("bytes");
+}
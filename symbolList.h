@@ -2,11 +2,28 @@
 #define SYMBOLLIST_H
 #define END_OF_LIST 0
 
+#include <pthread.h>
+#include <stdint.h>
+
+/*
+ * names are at most 31 characters and stored NUL padded to 32 bytes, so
+ * that two names compare a vector at a time
+ */
+#define SYMBOL_NAME_SIZE 32
+
+/*
+ * an entry in a symbol list, hash and length are worked out from the name
+ * when the entry is made and checked before the name itself.  A search
+ * only reads hash and next from most entries, so they come first
+ */
 typedef struct symbolEntry
 {
-    char type;
-    char name[31];
+    uint64_t hash;
     struct symbolEntry *next;
+    unsigned char length;
+    char type;
+    char *source;
+    char name[SYMBOL_NAME_SIZE];
 } symbolEntry;
 
 /*
@@ -24,7 +41,38 @@ typedef symbolEntry* symbolList;
  *      type    the symbolEntry type
  * returns:     the new list
  */
-symbolList insertSymbol(symbolList list, char name[31], char type);
+symbolList insertSymbol(symbolList list, const char *name, char type);
+
+/*
+ * function:    insertSymbolFrom
+ * description: create a new symbol that records the file it came from and
+ *              append to end of list
+ * params:
+ *      list    the symbolList to append to
+ *      name    the symbolEntry name
+ *      type    the symbolEntry type
+ *      source  the file the symbol came from, the string is not copied and
+ *              must outlive the list
+ * returns:     the new list
+ */
+symbolList insertSymbolFrom(symbolList list, const char *name, char type,
+    char *source);
+
+/*
+ * function:    appendSymbolFrom
+ * description: create a new symbol that records the file it came from and
+ *              append it after the last entry, without walking the list
+ * params:
+ *      list    the symbolList to append to
+ *      last    the list's last entry, END_OF_LIST if it is empty, set to
+ *              the new entry
+ *      name    the symbolEntry name
+ *      type    the symbolEntry type
+ *      source  the file the symbol came from, not copied
+ * returns:     the new list
+ */
+symbolList appendSymbolFrom(symbolList list, symbolEntry **last,
+    const char *name, char type, char *source);
 
 /*
  * function:    updateSymbol
@@ -35,7 +83,20 @@ symbolList insertSymbol(symbolList list, char name[31], char type);
  *      type    the symbolEntry type to update to
  * returns:     void
  */
-void updateSymbol(symbolList list, char name[31], char type);
+void updateSymbol(symbolList list, const char *name, char type);
+
+/*
+ * function:    updateSymbolFrom
+ * description: update a symbol in the list and the file it came from
+ * params:
+ *      list    the symbolList to update
+ *      name    the symbolEntry name to look for
+ *      type    the symbolEntry type to update to
+ *      source  the file the new type came from, not copied
+ * returns:     void
+ */
+void updateSymbolFrom(symbolList list, const char *name, char type,
+    char *source);
 
 /*
  * function:    findSymbol
@@ -47,7 +108,7 @@ void updateSymbol(symbolList list, char name[31], char type);
  *              match found in the list
  * returns:     count of matches
  */
-int findSymbol(symbolList list, char name[31], char *type);
+int findSymbol(symbolList list, const char *name, char *type);
 
 /*
  * function:    removeSymbol
@@ -57,7 +118,55 @@ int findSymbol(symbolList list, char name[31], char *type);
  *      name    the symbolEntry name to remove
  * returns:     the new list
  */
- symbolList removeSymbol(symbolList list, char name[31]);
+ symbolList removeSymbol(symbolList list, const char *name);
+
+/*
+ * function:    lookupSymbol
+ * description: find the first symbolEntry with a name
+ * params:
+ *      list    the symbolList to search in
+ *      name    the symbolEntry name to search for
+ * returns:     the entry, or END_OF_LIST if there is none
+ */
+symbolEntry *lookupSymbol(symbolList list, const char *name);
+
+/*
+ * function:    detachSymbol
+ * description: unlink the first symbolEntry with a name from a list
+ *              without freeing it, so that attachSymbol can put it back
+ * params:
+ *      list    the symbolList to remove from
+ *      name    the symbolEntry name to remove
+ *      entry   set to the unlinked entry, or END_OF_LIST if none matched
+ *      prev    set to the entry that was before it, END_OF_LIST if it was
+ *              the head
+ * returns:     the new list
+ */
+symbolList detachSymbol(symbolList list, const char *name,
+    symbolEntry **entry, symbolEntry **prev);
+
+/*
+ * function:    attachSymbol
+ * description: link an entry back into a list, the reverse of detachSymbol
+ * params:
+ *      list    the symbolList to add to
+ *      entry   the entry to link in
+ *      prev    the entry to link it after, END_OF_LIST for the head
+ * returns:     the new list
+ */
+symbolList attachSymbol(symbolList list, symbolEntry *entry,
+    symbolEntry *prev);
+
+/*
+ * function:    truncateSymbols
+ * description: free every entry after an entry
+ * params:
+ *      list    the symbolList to cut short
+ *      last    the entry to keep as the end of the list, END_OF_LIST to
+ *              free the whole list
+ * returns:     the new list
+ */
+symbolList truncateSymbols(symbolList list, symbolEntry *last);
 
 /*
  * function:    printSymbols
@@ -68,4 +177,127 @@ int findSymbol(symbolList list, char name[31], char *type);
  */
 void printSymbols(symbolList list);
 
-#endif
\ No newline at end of file
+/*
+ * a name interned in a symbolTable, interning the same name again gives
+ * the same symbolName.  The table only sets name and hash, the other
+ * fields are for one thread to keep track of the name's entries in its
+ * undefined and defined lists
+ */
+typedef struct symbolName
+{
+    char name[SYMBOL_NAME_SIZE];
+    uint64_t hash;
+    symbolEntry *undefined;
+    symbolEntry *first_defined;
+    symbolEntry *last_defined;
+    int defined_count;
+    struct symbolName *next;
+} symbolName;
+
+/*
+ * names are spread over shards by hash, each with its own lock and hash
+ * chains, so threads interning different names rarely wait on each other
+ */
+#define SYMBOL_TABLE_SHARDS 64
+
+typedef struct symbolShard
+{
+    pthread_mutex_t lock;
+    symbolName **buckets;
+    unsigned long size;
+    unsigned long count;
+} __attribute__((aligned(64))) symbolShard;
+
+typedef struct symbolTable
+{
+    symbolShard shards[SYMBOL_TABLE_SHARDS];
+} symbolTable;
+
+/*
+ * function:    createSymbolTable
+ * description: create an empty symbol table
+ * returns:     the new table
+ */
+symbolTable *createSymbolTable();
+
+/*
+ * function:    internSymbol
+ * description: find a name in the table, adding it if it is not there yet,
+ *              safe to call from several threads at once
+ * params:
+ *      table   the symbolTable
+ *      name    the name to intern
+ * returns:     the name's symbolName
+ */
+symbolName *internSymbol(symbolTable *table, const char *name);
+
+/*
+ * function:    findInterned
+ * description: find a name in the table without adding it, safe to call
+ *              from several threads at once
+ * params:
+ *      table   the symbolTable
+ *      name    the name to look for
+ * returns:     the name's symbolName, or 0 if it was never interned
+ */
+symbolName *findInterned(symbolTable *table, const char *name);
+
+/*
+ * function:    symbolTableCount
+ * description: count the names in a table
+ * params:
+ *      table   the symbolTable
+ * returns:     the number of names interned
+ */
+unsigned long symbolTableCount(symbolTable *table);
+
+/*
+ * function:    freeSymbolTable
+ * description: free a table and its names, no other thread may be using it
+ * params:
+ *      table   the symbolTable
+ * returns:     void
+ */
+void freeSymbolTable(symbolTable *table);
+
+/*
+ * function:    symbolNameHash
+ * description: 64 bit FNV-1a hash of a symbol name, the hash entries,
+ *              interned names and symbol indexes all use
+ * params:
+ *      name    the name
+ *      length  its length
+ * returns:     the hash
+ */
+uint64_t symbolNameHash(const char *name, int length);
+
+/*
+ * function:    symbolCompareKernel
+ * description: name the kernel that compares names, picked for the
+ *              processor when the program starts
+ * returns:     "avx2", "sse2" or "bytes"
+ */
+const char *symbolCompareKernel();
+
+/*
+ * function:    useSymbolCompareKernel
+ * description: compare names with a given kernel instead, for benchmarks
+ * params:
+ *      name    the kernel, as symbolCompareKernel names it
+ * returns:     1 if the processor supports it, 0 otherwise
+ */
+int useSymbolCompareKernel(const char *name);
+
+/*
+ * function:    symbolNamesEqual
+ * description: compare two names padded to SYMBOL_NAME_SIZE bytes with the
+ *              kernel in use, lookups only get this far once hash and
+ *              length match, so tests call it directly
+ * params:
+ *      a       the first name
+ *      b       the second name
+ * returns:     1 if they are the same, 0 otherwise
+ */
+int symbolNamesEqual(const char *a, const char *b);
+
+#endif
@@ -0,0 +1,152 @@
+#include "symbolList.h"
+#include "bool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Times finding every name of a list in it, once with a plain strcmp walk
+ * of the kind the list used to do and once with each compare kernel.
+ * Mangled C++ names share long prefixes, so a strcmp walk reads most of
+ * every name it passes, the case hashes and vector compares are for.
+ */
+
+#define BENCH_NAMES 2000
+#define BENCH_ROUNDS 3
+
+static void makeNames(char names[][31], char *prefix);
+static symbolList buildList(char names[][31]);
+static symbolEntry *strcmpFind(symbolList list, char *name);
+static double timeFinds(symbolList list, char names[][31], bool use_strcmp);
+static double now();
+
+char names[BENCH_NAMES][31];
+
+int main(int argc, char *argv[])
+{
+    char *prefixes[] = { "_ZNSt7__cxx1112basic_string", "sym" };
+    char *labels[] = { "long prefix", "short prefix" };
+    char *kernels[] = { "bytes", "sse2", "avx2" };
+    char *picked = (char*) symbolCompareKernel();
+    symbolList list;
+    double base, t;
+    int p, k;
+
+    printf("%d names, each found once, best of %d, kernel picked: %s\n",
+        BENCH_NAMES, BENCH_ROUNDS, picked);
+
+    for (p = 0; p < 2; p++)
+    {
+        makeNames(names, prefixes[p]);
+        list = buildList(names);
+
+        base = timeFinds(list, names, true);
+        printf("%-13s strcmp  %8.2f ms\n", labels[p], base * 1000);
+
+        for (k = 0; k < 3; k++)
+        {
+            if (!useSymbolCompareKernel(kernels[k]))
+                continue;
+            t = timeFinds(list, names, false);
+            printf("%-13s %-7s %8.2f ms  %5.2fx\n", labels[p], kernels[k],
+                t * 1000, base / t);
+        }
+        useSymbolCompareKernel(picked);
+
+        while (list != END_OF_LIST)
+            list = removeSymbol(list, list->name);
+    }
+
+    return 0;
+}
+
+/*
+ * function:    makeNames
+ * description: make distinct names that share a prefix, cut to 30
+ *              characters the way the resolver cuts them
+ */
+void makeNames(char names[][31], char *prefix)
+{
+    char full[64];
+    int i;
+
+    for (i = 0; i < BENCH_NAMES; i++)
+    {
+        // the counter goes last so names differ only in their final bytes
+        snprintf(full, sizeof(full), "%s%04d", prefix, i);
+        if (strlen(full) > 30)
+            memmove(full + 26, full + strlen(full) - 4, 5);
+        strcpy(names[i], full);
+    }
+}
+
+/*
+ * function:    buildList
+ * description: put the names in a list in order
+ */
+symbolList buildList(char names[][31])
+{
+    symbolList list = END_OF_LIST;
+    symbolEntry *last = END_OF_LIST;
+    int i;
+
+    for (i = 0; i < BENCH_NAMES; i++)
+        list = appendSymbolFrom(list, &last, names[i], 'T', 0);
+    return list;
+}
+
+/*
+ * function:    strcmpFind
+ * description: find a name by comparing it with each entry in turn
+ */
+symbolEntry *strcmpFind(symbolList list, char *name)
+{
+    while (list != END_OF_LIST && strcmp(list->name, name) != 0)
+        list = list->next;
+    return list;
+}
+
+/*
+ * function:    timeFinds
+ * description: time finding every name, the best of a few rounds
+ * returns:     seconds taken
+ */
+double timeFinds(symbolList list, char names[][31], bool use_strcmp)
+{
+    double best = 0, start, t;
+    symbolEntry *found;
+    int round, i;
+
+    for (round = 0; round < BENCH_ROUNDS; round++)
+    {
+        start = now();
+        for (i = 0; i < BENCH_NAMES; i++)
+        {
+            found = use_strcmp ? strcmpFind(list, names[i]) :
+                lookupSymbol(list, names[i]);
+            if (found == END_OF_LIST)
+            {
+                fprintf(stderr, "%s was not found\n", names[i]);
+                exit(1);
+            }
+        }
+        t = now() - start;
+        if (round == 0 || t < best)
+            best = t;
+    }
+
+    return best;
+}
+
+/*
+ * function:    now
+ * description: a monotonic clock in seconds
+ */
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -1,4 +1,5 @@
 #include "symbolList.h"
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -204,6 +205,274 @@ void testFindSymbol()
     printf("passed\n");
 }
 
+void testAppendSymbol()
+{
+    printf("test append symbol...\n");
+
+    symbolList list = END_OF_LIST;
+    symbolEntry *last = END_OF_LIST;
+
+    list = appendSymbolFrom(list, &last, NAME_1, TYPE_1, 0);
+    list = appendSymbolFrom(list, &last, NAME_2, TYPE_2, NAME_3);
+
+    assertTrue(strcmp(list->name, NAME_1) == 0,
+        "name at index 0 does not match appended name");
+
+    assertTrue(list->next == last,
+        "last should be the entry appended last");
+
+    assertTrue(last->next == END_OF_LIST,
+        "end of list should be null");
+
+    assertTrue(strcmp(last->name, NAME_2) == 0 && last->source == NAME_3,
+        "entry at index 1 does not match appended entry");
+
+    printf("passed\n");
+}
+
+void testDetachAndAttachSymbol()
+{
+    printf("test detach and attach symbol...\n");
+
+    symbolList list = END_OF_LIST;
+    symbolEntry *entry;
+    symbolEntry *prev;
+
+    list = insertSymbol(list, NAME_1, TYPE_1);
+    list = insertSymbol(list, NAME_2, TYPE_2);
+    list = insertSymbol(list, NAME_3, TYPE_3);
+
+    list = detachSymbol(list, NAME_2, &entry, &prev);
+
+    assertTrue(entry != END_OF_LIST && strcmp(entry->name, NAME_2) == 0,
+        "detach should return the matching entry");
+
+    assertTrue(prev == list,
+        "prev should be the entry before the detached one");
+
+    assertTrue(strcmp(list->next->name, NAME_3) == 0,
+        "detached entry should no longer be in the list");
+
+    list = attachSymbol(list, entry, prev);
+
+    assertTrue(list->next == entry && strcmp(entry->next->name, NAME_3) == 0,
+        "attach should put the entry back where it was");
+
+    list = detachSymbol(list, NAME_1, &entry, &prev);
+
+    assertTrue(prev == END_OF_LIST && strcmp(list->name, NAME_2) == 0,
+        "detaching the head should leave the next entry as head");
+
+    list = attachSymbol(list, entry, prev);
+
+    assertTrue(list == entry && strcmp(list->next->name, NAME_2) == 0,
+        "attaching after END_OF_LIST should restore the head");
+
+    printf("passed\n");
+}
+
+void testTruncateSymbols()
+{
+    printf("test truncate symbols...\n");
+
+    symbolList list = END_OF_LIST;
+
+    list = insertSymbol(list, NAME_1, TYPE_1);
+    list = insertSymbol(list, NAME_2, TYPE_2);
+    list = insertSymbol(list, NAME_3, TYPE_3);
+
+    list = truncateSymbols(list, list);
+
+    assertTrue(list != END_OF_LIST && list->next == END_OF_LIST,
+        "only the entry kept as last should remain");
+
+    list = truncateSymbols(list, END_OF_LIST);
+
+    assertTrue(list == END_OF_LIST,
+        "truncating after END_OF_LIST should empty the list");
+
+    printf("passed\n");
+}
+
+void testInternSymbol()
+{
+    printf("test intern symbol...\n");
+
+    symbolTable *table = createSymbolTable();
+    symbolName *first = internSymbol(table, NAME_1);
+
+    assertTrue(strcmp(first->name, NAME_1) == 0,
+        "interned name does not match");
+
+    assertTrue(internSymbol(table, NAME_1) == first,
+        "interning a name twice should give the same symbolName");
+
+    assertTrue(internSymbol(table, NAME_2) != first,
+        "different names should give different symbolNames");
+
+    assertTrue(findInterned(table, NAME_2) != 0 &&
+        findInterned(table, NAME_3) == 0,
+        "find should only see interned names");
+
+    assertTrue(symbolTableCount(table) == 2,
+        "table should hold two names");
+
+    freeSymbolTable(table);
+    printf("passed\n");
+}
+
+/* stress test data: */
+#define STRESS_THREADS 8
+#define STRESS_NAMES 20000
+
+typedef struct stressWorker
+{
+    pthread_t thread;
+    symbolTable *table;
+    int start;
+    symbolName **found;
+} stressWorker;
+
+void stressName(int i, char name[31])
+{
+    // shared prefixes, like mangled C++ names
+    sprintf(name, "_ZN9namespace%dE%d", i % 7, i);
+}
+
+void *stressIntern(void *arg)
+{
+    stressWorker *worker = (stressWorker*) arg;
+    char name[31];
+    int i, n;
+
+    // every thread interns every name, each starting somewhere else
+    for (n = 0; n < STRESS_NAMES; n++)
+    {
+        i = (worker->start + n) % STRESS_NAMES;
+        stressName(i, name);
+        worker->found[i] = internSymbol(worker->table, name);
+    }
+
+    return 0;
+}
+
+void testInternSymbolConcurrently()
+{
+    printf("test intern symbol from %d threads...\n", STRESS_THREADS);
+
+    symbolTable *table = createSymbolTable();
+    stressWorker workers[STRESS_THREADS];
+    char name[31];
+    int i, t;
+
+    for (t = 0; t < STRESS_THREADS; t++)
+    {
+        workers[t].table = table;
+        workers[t].start = t * (STRESS_NAMES / STRESS_THREADS);
+        workers[t].found = (symbolName**) malloc(STRESS_NAMES * sizeof(symbolName*));
+        assertTrue(workers[t].found != 0, "malloc failed");
+        assertTrue(pthread_create(&workers[t].thread, 0, stressIntern,
+            &workers[t]) == 0, "unable to start thread");
+    }
+
+    for (t = 0; t < STRESS_THREADS; t++)
+        pthread_join(workers[t].thread, 0);
+
+    assertTrue(symbolTableCount(table) == STRESS_NAMES,
+        "each name should have been interned once");
+
+    for (i = 0; i < STRESS_NAMES; i++)
+    {
+        stressName(i, name);
+        assertTrue(strcmp(workers[0].found[i]->name, name) == 0,
+            "interned name does not match");
+        assertTrue(findInterned(table, name) == workers[0].found[i],
+            "find should give the interned symbolName");
+        for (t = 1; t < STRESS_THREADS; t++)
+            assertTrue(workers[t].found[i] == workers[0].found[i],
+                "all threads should get the same symbolName for a name");
+    }
+
+    for (t = 0; t < STRESS_THREADS; t++)
+        free(workers[t].found);
+    freeSymbolTable(table);
+    printf("passed\n");
+}
+
+void testLookupSimilarNames()
+{
+    printf("test lookup of names sharing a prefix...\n");
+
+    char long_a[31], long_b[31], short_a[31];
+    symbolList list = END_OF_LIST;
+    symbolEntry *found;
+
+    // names sharing 29 characters, and one that is a prefix of the others
+    memset(long_a, 'x', 30);
+    memset(long_b, 'x', 30);
+    long_a[30] = long_b[30] = '\0';
+    long_b[29] = 'y';
+    strcpy(short_a, long_a);
+    short_a[29] = '\0';
+
+    list = insertSymbol(list, long_a, TYPE_1);
+    list = insertSymbol(list, long_b, TYPE_2);
+    list = insertSymbol(list, short_a, TYPE_3);
+
+    found = lookupSymbol(list, long_a);
+    assertTrue(found != END_OF_LIST && found->type == TYPE_1,
+        "name differing in its last character was confused");
+    found = lookupSymbol(list, long_b);
+    assertTrue(found != END_OF_LIST && found->type == TYPE_2,
+        "name differing in its last character was confused");
+    found = lookupSymbol(list, short_a);
+    assertTrue(found != END_OF_LIST && found->type == TYPE_3,
+        "prefix of a name was confused with the name");
+    assertTrue(lookupSymbol(list, "xxxx") == END_OF_LIST,
+        "name not in list should not be found");
+
+    list = truncateSymbols(list, END_OF_LIST);
+    printf("passed\n");
+}
+
+void testCompareKernels()
+{
+    char *kernels[] = { "bytes", "sse2", "avx2" };
+    char *picked = (char*) symbolCompareKernel();
+    int differ_at[] = { 0, 15, 16, 30 };
+    char a[SYMBOL_NAME_SIZE] __attribute__((aligned(32)));
+    char b[SYMBOL_NAME_SIZE] __attribute__((aligned(32)));
+    int k, i;
+
+    for (k = 0; k < 3; k++)
+    {
+        if (!useSymbolCompareKernel(kernels[k]))
+            continue;
+        printf("test compare names with the %s kernel...\n", kernels[k]);
+
+        // full length padded names, equal except for one byte, where each
+        // byte sits on either side of a 16 byte half or at the end
+        memset(a, 'x', SYMBOL_NAME_SIZE - 1);
+        a[SYMBOL_NAME_SIZE - 1] = '\0';
+        memcpy(b, a, SYMBOL_NAME_SIZE);
+        assertTrue(symbolNamesEqual(a, b), "equal names should compare equal");
+
+        for (i = 0; i < 4; i++)
+        {
+            memcpy(b, a, SYMBOL_NAME_SIZE);
+            b[differ_at[i]] = 'y';
+            assertTrue(!symbolNamesEqual(a, b),
+                "names differing in one byte should not compare equal");
+            assertTrue(!symbolNamesEqual(b, a),
+                "names differing in one byte should not compare equal");
+        }
+
+        printf("passed\n");
+    }
+
+    useSymbolCompareKernel(picked);
+}
+
 int main(int argc, char *argv)
 {
     printf("Starting symbol list tests...\n");
@@ -218,4 +487,14 @@ int main(int argc, char *argv)
 
     testUpdateSymbol();
     testFindSymbol();
+
+    testAppendSymbol();
+    testDetachAndAttachSymbol();
+    testTruncateSymbols();
+
+    testInternSymbol();
+    testInternSymbolConcurrently();
+
+    testLookupSimilarNames();
+    testCompareKernels();
 }
\ No newline at end of file
@@ -0,0 +1,84 @@
+/*
+ * Name: symbolQuery
+ * Description: This program answers questions about a symbol index written
+ *              by resolve --index.  Given symbol names it prints the type
+ *              and defining file of each one, or reports that the symbol is
+ *              not defined.  Given no names it prints the whole table in
+ *              sorted order.  The index is mapped rather than read, so a
+ *              lookup only touches the pages it needs.
+ *
+ *              The exit status is 1 if any of the names was not defined, and
+ *              2 if the index cannot be read or is corrupt.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "symbolIndex.h"
+#include "bool.h"
+
+static void printEntry(char *name, char type, const char *source);
+
+int main(int argc, char *argv[])
+{
+    symbolIndex index;
+    char name[256];
+    char type;
+    const char *source;
+    uint32_t i;
+    int status = 0;
+
+    if (argc < 2)
+    {
+        printf("usage: symbolQuery index [name...]\n");
+        exit(2);
+    }
+
+    if (!openSymbolIndex(&index, argv[1]))
+        exit(2);
+
+    if (argc == 2)
+    {
+        for (i = 0; i < index.header->count; i++)
+        {
+            if (!symbolIndexEntry(&index, i, name, &type, &source))
+            {
+                fprintf(stderr, "%s: entry %u is corrupt\n", argv[1], i);
+                closeSymbolIndex(&index);
+                exit(2);
+            }
+            printEntry(name, type, source);
+        }
+    }
+
+    for (i = 2; i < (uint32_t) argc; i++)
+    {
+        if (lookupSymbolIndex(&index, argv[i], &type, &source))
+            printEntry(argv[i], type, source);
+        else if (index.corrupt)
+        {
+            fprintf(stderr, "%s: corrupt entry met looking up %s\n", argv[1],
+                argv[i]);
+            closeSymbolIndex(&index);
+            exit(2);
+        }
+        else
+        {
+            printf("%s: not defined\n", argv[i]);
+            status = 1;
+        }
+    }
+
+    closeSymbolIndex(&index);
+    return status;
+}
+
+/*
+ * function:    printEntry
+ * description: print one symbol in the same columns as resolve's defined
+ *              symbol table, followed by the defining file
+ * returns:     void
+ */
+void printEntry(char *name, char type, const char *source)
+{
+    printf("%-32s %c %s\n", name, type, source == 0 ? "-" : source);
+}
@@ -0,0 +1,974 @@
+#include "symbolSource.h"
+#include "contentHash.h"
+#include <elf.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * the parts of an ELF section header the native reader needs, filled in
+ * from either the 32 or 64 bit layout
+ */
+typedef struct sectionInfo
+{
+    uint32_t type;
+    uint64_t flags;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t link;
+    uint64_t entsize;
+} sectionInfo;
+
+/*
+ * a symbol's full name and type plus the symbol table index it came from,
+ * used to keep the sort deterministic between equal names
+ */
+typedef struct sortRecord
+{
+    const char *name;
+    char type;
+    uint32_t index;
+} sortRecord;
+
+/*
+ * a file handed to nm and its place in the batch, sorted to find files
+ * named more than once
+ */
+typedef struct nmFile
+{
+    const char *name;
+    int index;
+} nmFile;
+
+/*
+ * the file the ELF parser is reading, either all of it in memory or a
+ * member of an open archive that is read a range at a time, within a
+ * budget, as the parser asks for the ranges
+ */
+#define ELF_READER_BUFFERS 5
+
+typedef struct elfReader
+{
+    unsigned char *data;
+    int fd;
+    uint64_t base;
+    uint64_t size;
+    uint64_t budget;
+    uint64_t used;
+    unsigned char *buffers[ELF_READER_BUFFERS];
+    int buffer_count;
+} elfReader;
+
+/*
+ * a slot in the content cache, the records of the first file read with
+ * this content
+ */
+typedef struct cacheEntry
+{
+    uint64_t hash;
+    uint64_t size;
+    fileSymbols symbols;
+    bool used;
+} cacheEntry;
+
+static cacheEntry *cache = 0;
+static unsigned long cache_size = 0;
+static unsigned long cache_count = 0;
+static int parsed_count = 0;
+static int reused_count = 0;
+
+static void cacheReserve(unsigned long extra);
+static cacheEntry *cacheSlot(uint64_t hash, uint64_t size);
+static bool readNative(char **files, int count, fileSymbols *symbols);
+static bool readNm(char **files, int count, fileSymbols *symbols);
+static bool readElf(char *filename, fileSymbols *symbols);
+static bool parseElf(elfReader *reader, fileSymbols *symbols);
+static const unsigned char *fetchElf(elfReader *reader, uint64_t offset,
+    uint64_t length);
+static void releaseElf(elfReader *reader);
+static char symbolType(unsigned char info, uint16_t shndx,
+    sectionInfo *sections, uint32_t section_count);
+static int compareRecords(const void *a, const void *b);
+static int compareNmFiles(const void *a, const void *b);
+static bool appendRecord(fileSymbols *symbols, int *capacity, char type,
+    const char *name);
+static char *quoteArgument(char *arg, char *out);
+
+symbolSource nativeSource = { "native", readNative };
+symbolSource nmSource = { "nm", readNm };
+
+/*
+ * function:    findSymbolSource
+ * description: look up a backend by name
+ * params:
+ *      name    the backend's name, "native" or "nm"
+ * returns:     the backend, or 0 if there is no backend with that name
+ */
+symbolSource *findSymbolSource(char *name)
+{
+    if (strcmp(name, nativeSource.name) == 0)
+        return &nativeSource;
+    if (strcmp(name, nmSource.name) == 0)
+        return &nmSource;
+    return 0;
+}
+
+/*
+ * function:    readFileSymbols
+ * description: read the symbols of a list of files, at most batch files
+ *              are handed to the backend at a time
+ * params:
+ *      source  the backend to read with
+ *      files   the files to read
+ *      count   the number of files
+ *      batch   the most files to pass to one backend call
+ *      symbols array of count fileSymbols to fill in
+ * returns:     true on success, false otherwise
+ */
+bool readFileSymbols(symbolSource *source, char **files, int count,
+    int batch, fileSymbols *symbols)
+{
+    cacheEntry **entries = (cacheEntry**) malloc((count + 1) * sizeof(cacheEntry*));
+    char **misses = (char**) malloc((count + 1) * sizeof(char*));
+    int *slots = (int*) malloc((count + 1) * sizeof(int));
+    fileSymbols *found = (fileSymbols*) malloc((count + 1) * sizeof(fileSymbols));
+    uint64_t hash, size;
+    int i, n, miss_count = 0;
+    bool ok = true;
+
+    if (entries == 0 || misses == 0 || slots == 0 || found == 0)
+    {
+        perror("in symbolSource - malloc unable to allocate space");
+        exit(0);
+    }
+
+    if (batch < 1)
+        batch = 1;
+
+    // make room up front so the slots found below stay put
+    cacheReserve(count);
+
+    // only content not seen before goes to the backend, a repeat within
+    // this call waits for the first copy
+    for (i = 0; i < count; i++)
+    {
+        entries[i] = 0;
+        if (hashFile(files[i], &hash, &size))
+        {
+            entries[i] = cacheSlot(hash, size);
+            if (entries[i]->used)
+            {
+                reused_count++;
+                continue;
+            }
+            entries[i]->used = true;
+            entries[i]->hash = hash;
+            entries[i]->size = size;
+            cache_count++;
+        }
+        slots[miss_count] = i;
+        misses[miss_count++] = files[i];
+    }
+
+    for (i = 0; ok && i < miss_count; i += n)
+    {
+        n = miss_count - i < batch ? miss_count - i : batch;
+        ok = source->read(&misses[i], n, &found[i]);
+    }
+    parsed_count += miss_count;
+
+    for (i = 0; ok && i < miss_count; i++)
+    {
+        if (entries[slots[i]] != 0)
+            entries[slots[i]]->symbols = found[i];
+        else
+            free(found[i].records);
+    }
+
+    for (i = 0; ok && i < count; i++)
+    {
+        if (entries[i] == 0)
+        {
+            symbols[i].records = 0;
+            symbols[i].count = 0;
+            continue;
+        }
+        symbols[i] = entries[i]->symbols;
+    }
+
+    free(entries);
+    free(misses);
+    free(slots);
+    free(found);
+    return ok;
+}
+
+/*
+ * function:    freeFileSymbols
+ * description: let go of the records read for a file, they stay in the
+ *              content cache for the next file with the same content
+ * params:
+ *      symbols the file's symbols
+ * returns:     void
+ */
+void freeFileSymbols(fileSymbols *symbols)
+{
+    symbols->records = 0;
+    symbols->count = 0;
+}
+
+/*
+ * function:    freeSymbolCache
+ * description: free the content cache and the records in it, records
+ *              readFileSymbols handed out before are gone after this
+ * returns:     void
+ */
+void freeSymbolCache()
+{
+    unsigned long i;
+
+    for (i = 0; i < cache_size; i++)
+        if (cache[i].used)
+            free(cache[i].symbols.records);
+
+    free(cache);
+    cache = 0;
+    cache_size = 0;
+    cache_count = 0;
+}
+
+/*
+ * function:    symbolCacheStats
+ * description: report how well the content cache did
+ * params:
+ *      parsed  set to the number of files a backend had to read
+ *      reused  set to the number of files whose records were reused
+ * returns:     void
+ */
+void symbolCacheStats(int *parsed, int *reused)
+{
+    *parsed = parsed_count;
+    *reused = reused_count;
+}
+
+/*
+ * function:    cacheReserve
+ * description: grow the content cache so that extra more entries keep it
+ *              at most half full
+ * params:
+ *      extra   the number of entries about to be added
+ * returns:     void
+ */
+void cacheReserve(unsigned long extra)
+{
+    cacheEntry *old = cache;
+    unsigned long old_size = cache_size;
+    unsigned long i, j;
+
+    if ((cache_count + extra) * 2 <= cache_size)
+        return;
+
+    if (cache_size == 0)
+        cache_size = 256;
+    while ((cache_count + extra) * 2 > cache_size)
+        cache_size *= 2;
+
+    cache = (cacheEntry*) calloc(cache_size, sizeof(cacheEntry));
+    if (cache == 0)
+    {
+        perror("in symbolSource - malloc unable to allocate space");
+        exit(0);
+    }
+    for (i = 0; i < old_size; i++)
+    {
+        if (!old[i].used)
+            continue;
+        j = old[i].hash & (cache_size - 1);
+        while (cache[j].used)
+            j = (j + 1) & (cache_size - 1);
+        cache[j] = old[i];
+    }
+    free(old);
+}
+
+/*
+ * function:    cacheSlot
+ * description: find the content cache slot for a hash and size
+ * params:
+ *      hash    the content's hash
+ *      size    the content's size
+ * returns:     the matching slot if there is one, or the empty slot to
+ *              fill in
+ */
+cacheEntry *cacheSlot(uint64_t hash, uint64_t size)
+{
+    unsigned long i;
+
+    i = hash & (cache_size - 1);
+    while (cache[i].used && (cache[i].hash != hash || cache[i].size != size))
+        i = (i + 1) & (cache_size - 1);
+    return &cache[i];
+}
+
+/*
+ * function:    readNative
+ * description: read ELF files directly, the files that are not ELF are
+ *              read with one nm batch
+ * params:
+ *      files   the files to read
+ *      count   the number of files
+ *      symbols array of count fileSymbols to fill in
+ * returns:     true on success, false otherwise
+ */
+bool readNative(char **files, int count, fileSymbols *symbols)
+{
+    char **others = (char**) malloc(count * sizeof(char*));
+    int *slots = (int*) malloc(count * sizeof(int));
+    fileSymbols *found = (fileSymbols*) malloc(count * sizeof(fileSymbols));
+    int i, other_count = 0;
+    bool ok = true;
+
+    if (others == 0 || slots == 0 || found == 0)
+    {
+        perror("in symbolSource - malloc unable to allocate space");
+        exit(0);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (!readElf(files[i], &symbols[i]))
+        {
+            slots[other_count] = i;
+            others[other_count++] = files[i];
+        }
+    }
+
+    if (other_count > 0)
+    {
+        ok = readNm(others, other_count, found);
+        for (i = 0; ok && i < other_count; i++)
+            symbols[slots[i]] = found[i];
+    }
+
+    free(others);
+    free(slots);
+    free(found);
+    return ok;
+}
+
+/*
+ * function:    readNm
+ * description: run nm -A over all of the files and hand each output line
+ *              to the file it names, nm prints files in argument order
+ * params:
+ *      files   the files to read
+ *      count   the number of files
+ *      symbols array of count fileSymbols to fill in
+ * returns:     true on success, false if nm could not be run or failed on
+ *              any of the files, nothing is returned then
+ */
+bool readNm(char **files, int count, fileSymbols *symbols)
+{
+    int *capacity = (int*) calloc(count, sizeof(int));
+    int *first = (int*) malloc(count * sizeof(int));
+    nmFile *sorted = (nmFile*) malloc(count * sizeof(nmFile));
+    size_t command_len = 32;
+    char *command, *end;
+    char *line = 0;
+    size_t line_size = 0;
+    char name[31];
+    char type;
+    int i, j, status, cur = 0;
+    FILE *fp;
+
+    if (capacity == 0 || first == 0 || sorted == 0)
+    {
+        perror("in symbolSource - malloc unable to allocate space");
+        exit(0);
+    }
+
+    // a file named twice in one batch is only passed to nm once, the
+    // output could not be told apart otherwise.  Sorting by name puts the
+    // copies next to the first one
+    for (i = 0; i < count; i++)
+    {
+        symbols[i].records = 0;
+        symbols[i].count = 0;
+        sorted[i].name = files[i];
+        sorted[i].index = i;
+    }
+    qsort(sorted, count, sizeof(nmFile), compareNmFiles);
+    for (i = 0; i < count; i++)
+    {
+        j = sorted[i].index;
+        if (i > 0 && strcmp(sorted[i].name, sorted[i - 1].name) == 0)
+            first[j] = first[sorted[i - 1].index];
+        else
+        {
+            first[j] = j;
+            command_len += strlen(files[j]) * 4 + 3;
+        }
+    }
+    free(sorted);
+
+    // the C locale keeps nm's name order the same as the native reader's
+    command = (char*) malloc(command_len);
+    if (command == 0)
+    {
+        perror("in symbolSource - malloc unable to allocate space");
+        exit(0);
+    }
+    end = command + sprintf(command, "LC_ALL=C nm -A");
+    for (i = 0; i < count; i++)
+        if (first[i] == i)
+            end = quoteArgument(files[i], end);
+
+    fp = popen(command, "r");
+    free(command);
+    if (fp == NULL)
+    {
+        free(capacity);
+        free(first);
+        return false;
+    }
+
+    while (getline(&line, &line_size, fp) != -1)
+    {
+        size_t len;
+        char *rest;
+
+        // find the file this line belongs to, starting at the last one
+        for (i = cur; i < count; i++)
+        {
+            len = strlen(files[i]);
+            if (first[i] == i && strncmp(line, files[i], len) == 0 &&
+                line[len] == ':')
+                break;
+        }
+        if (i == count)
+            continue;
+        cur = i;
+        rest = line + len + 1;
+
+        if (sscanf(rest, "%*x %c %30s", &type, name) != 2 &&
+            sscanf(rest, " %c %30s", &type, name) != 2)
+            continue;
+        appendRecord(&symbols[cur], &capacity[cur], type, name);
+    }
+    free(line);
+    status = pclose(fp);
+
+    // nm has already said what went wrong, the records it printed before
+    // that are not enough to go on
+    if (status != 0)
+    {
+        for (i = 0; i < count; i++)
+        {
+            free(symbols[i].records);
+            symbols[i].records = 0;
+            symbols[i].count = 0;
+        }
+        free(capacity);
+        free(first);
+        return false;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (first[i] != i)
+        {
+            j = first[i];
+            symbols[i].count = symbols[j].count;
+            symbols[i].records = (symbolRecord*)
+                malloc((symbols[j].count + 1) * sizeof(symbolRecord));
+            if (symbols[i].records == 0)
+            {
+                perror("in symbolSource - malloc unable to allocate space");
+                exit(0);
+            }
+            memcpy(symbols[i].records, symbols[j].records,
+                symbols[j].count * sizeof(symbolRecord));
+        }
+    }
+
+    free(capacity);
+    free(first);
+    return true;
+}
+
+/*
+ * function:    readElf
+ * description: read a file and parse it as ELF
+ * params:
+ *      filename    the file to read
+ *      symbols     gets the file's symbols
+ * returns:     true if the file was ELF, false if another backend should
+ *              read it
+ */
+bool readElf(char *filename, fileSymbols *symbols)
+{
+    unsigned char *data;
+    elfReader reader;
+    long size;
+    bool ok;
+    FILE *fp;
+
+    fp = fopen(filename, "rb");
+    if (fp == NULL)
+        return false;
+
+    if (fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 0 ||
+        fseek(fp, 0, SEEK_SET) != 0)
+    {
+        fclose(fp);
+        return false;
+    }
+
+    data = (unsigned char*) malloc(size + 1);
+    if (data == 0)
+    {
+        perror("in symbolSource - malloc unable to allocate space");
+        exit(0);
+    }
+
+    memset(&reader, 0, sizeof(reader));
+    reader.data = data;
+    reader.size = size;
+    ok = fread(data, 1, size, fp) == (size_t) size &&
+        parseElf(&reader, symbols);
+
+    free(data);
+    fclose(fp);
+    return ok;
+}
+
+/*
+ * function:    readElfMember
+ * description: parse an ELF member of an archive in place, only the parts
+ *              that hold the symbols are read
+ * params:
+ *      fd          the open archive
+ *      offset      where the member starts
+ *      size        the member's size
+ *      budget      the most bytes that may be read into memory at once
+ *      symbols     gets the member's symbols
+ * returns:     true if the member was ELF and fit the budget, false if
+ *              another backend should read it
+ */
+bool readElfMember(int fd, uint64_t offset, uint64_t size, uint64_t budget,
+    fileSymbols *symbols)
+{
+    elfReader reader;
+    bool ok;
+
+    memset(&reader, 0, sizeof(reader));
+    reader.fd = fd;
+    reader.base = offset;
+    reader.size = size;
+    reader.budget = budget;
+
+    ok = parseElf(&reader, symbols);
+    releaseElf(&reader);
+    return ok;
+}
+
+/*
+ * function:    fetchElf
+ * description: get a range of the file being parsed
+ * params:
+ *      reader  the file
+ *      offset  where the range starts
+ *      length  how long the range is
+ * returns:     the range's bytes, or 0 if the range is outside the file or
+ *              would take the reader over its budget
+ */
+const unsigned char *fetchElf(elfReader *reader, uint64_t offset, uint64_t length)
+{
+    unsigned char *buffer;
+    uint64_t done = 0;
+    ssize_t n;
+
+    if (offset > reader->size || length > reader->size - offset)
+        return 0;
+    if (reader->data != 0)
+        return reader->data + offset;
+
+    if (length > reader->budget - reader->used ||
+        reader->buffer_count == ELF_READER_BUFFERS)
+        return 0;
+
+    buffer = (unsigned char*) malloc(length + 1);
+    if (buffer == 0)
+    {
+        perror("in symbolSource - malloc unable to allocate space");
+        exit(0);
+    }
+
+    while (done < length)
+    {
+        n = pread(reader->fd, buffer + done, length - done,
+            reader->base + offset + done);
+        if (n <= 0)
+        {
+            free(buffer);
+            return 0;
+        }
+        done += n;
+    }
+
+    reader->used += length;
+    reader->buffers[reader->buffer_count++] = buffer;
+    return buffer;
+}
+
+/*
+ * function:    releaseElf
+ * description: free the ranges a reader fetched
+ * params:
+ *      reader  the reader
+ * returns:     void
+ */
+void releaseElf(elfReader *reader)
+{
+    while (reader->buffer_count > 0)
+        free(reader->buffers[--reader->buffer_count]);
+    reader->used = 0;
+}
+
+/*
+ * function:    parseElf
+ * description: collect the symbols of a little endian ELF file the way nm
+ *              lists them
+ * params:
+ *      reader      the file
+ *      symbols     gets the file's symbols
+ * returns:     true if the file could be parsed, false otherwise
+ */
+bool parseElf(elfReader *reader, fileSymbols *symbols)
+{
+    bool is64;
+    uint64_t shoff, symsize, strsize, entsize;
+    uint32_t shnum, shentsize, i, count;
+    const unsigned char *ident, *headers, *symtab_data, *strtab;
+    sectionInfo *sections;
+    sectionInfo *symtab = 0;
+    sortRecord *sorted;
+    int capacity = 0;
+
+    symbols->records = 0;
+    symbols->count = 0;
+
+    ident = fetchElf(reader, 0, reader->size < sizeof(Elf64_Ehdr) ?
+        reader->size : sizeof(Elf64_Ehdr));
+    if (ident == 0 || reader->size < EI_NIDENT ||
+        memcmp(ident, ELFMAG, SELFMAG) != 0 || ident[EI_DATA] != ELFDATA2LSB)
+        return false;
+
+    is64 = ident[EI_CLASS] == ELFCLASS64;
+    if (!is64 && ident[EI_CLASS] != ELFCLASS32)
+        return false;
+
+    if (is64)
+    {
+        const Elf64_Ehdr *eh = (const Elf64_Ehdr*) ident;
+        if (reader->size < sizeof(*eh))
+            return false;
+        shoff = eh->e_shoff;
+        shnum = eh->e_shnum;
+        shentsize = eh->e_shentsize;
+        if (shoff != 0 && shentsize < sizeof(Elf64_Shdr))
+            return false;
+    }
+    else
+    {
+        const Elf32_Ehdr *eh = (const Elf32_Ehdr*) ident;
+        if (reader->size < sizeof(*eh))
+            return false;
+        shoff = eh->e_shoff;
+        shnum = eh->e_shnum;
+        shentsize = eh->e_shentsize;
+        if (shoff != 0 && shentsize < sizeof(Elf32_Shdr))
+            return false;
+    }
+
+    // no section headers, nothing for nm to list
+    if (shoff == 0)
+        return true;
+
+    // more than SHN_LORESERVE sections keeps the count in section 0
+    if (shnum == 0)
+    {
+        headers = fetchElf(reader, shoff, shentsize);
+        if (headers == 0)
+            return false;
+        shnum = is64 ? (uint32_t) ((const Elf64_Shdr*) headers)->sh_size :
+            ((const Elf32_Shdr*) headers)->sh_size;
+    }
+
+    headers = fetchElf(reader, shoff, (uint64_t) shnum * shentsize);
+    if (headers == 0)
+        return false;
+
+    sections = (sectionInfo*) malloc((shnum + 1) * sizeof(sectionInfo));
+    if (sections == 0)
+    {
+        perror("in symbolSource - malloc unable to allocate space");
+        exit(0);
+    }
+
+    for (i = 0; i < shnum; i++)
+    {
+        const unsigned char *p = headers + (uint64_t) i * shentsize;
+        if (is64)
+        {
+            const Elf64_Shdr *sh = (const Elf64_Shdr*) p;
+            sections[i].type = sh->sh_type;
+            sections[i].flags = sh->sh_flags;
+            sections[i].offset = sh->sh_offset;
+            sections[i].size = sh->sh_size;
+            sections[i].link = sh->sh_link;
+            sections[i].entsize = sh->sh_entsize;
+        }
+        else
+        {
+            const Elf32_Shdr *sh = (const Elf32_Shdr*) p;
+            sections[i].type = sh->sh_type;
+            sections[i].flags = sh->sh_flags;
+            sections[i].offset = sh->sh_offset;
+            sections[i].size = sh->sh_size;
+            sections[i].link = sh->sh_link;
+            sections[i].entsize = sh->sh_entsize;
+        }
+        if (sections[i].type == SHT_SYMTAB && symtab == 0)
+            symtab = &sections[i];
+    }
+
+    // a file without a symbol table has no symbols
+    if (symtab == 0)
+    {
+        free(sections);
+        return true;
+    }
+
+    entsize = is64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+    if (symtab->link >= shnum || symtab->entsize < entsize)
+    {
+        free(sections);
+        return false;
+    }
+    symsize = symtab->size;
+    strsize = sections[symtab->link].size;
+    symtab_data = fetchElf(reader, symtab->offset, symsize);
+    strtab = fetchElf(reader, sections[symtab->link].offset, strsize);
+    if (symtab_data == 0 || strtab == 0 || strsize == 0 ||
+        strtab[strsize - 1] != '\0')
+    {
+        free(sections);
+        return false;
+    }
+
+    count = (uint32_t) (symsize / symtab->entsize);
+    sorted = (sortRecord*) malloc((count + 1) * sizeof(sortRecord));
+    if (sorted == 0)
+    {
+        perror("in symbolSource - malloc unable to allocate space");
+        exit(0);
+    }
+
+    // symbol 0 is always the null symbol
+    for (i = 1; i < count; i++)
+    {
+        const unsigned char *p = symtab_data + (uint64_t) i * symtab->entsize;
+        uint32_t name_off;
+        unsigned char info;
+        uint16_t shndx;
+
+        if (is64)
+        {
+            const Elf64_Sym *sym = (const Elf64_Sym*) p;
+            name_off = sym->st_name;
+            info = sym->st_info;
+            shndx = sym->st_shndx;
+        }
+        else
+        {
+            const Elf32_Sym *sym = (const Elf32_Sym*) p;
+            name_off = sym->st_name;
+            info = sym->st_info;
+            shndx = sym->st_shndx;
+        }
+
+        // nm leaves out section and file symbols unless asked for them
+        if (ELF64_ST_TYPE(info) == STT_SECTION ||
+            ELF64_ST_TYPE(info) == STT_FILE ||
+            name_off >= strsize || strtab[name_off] == '\0')
+            continue;
+
+        sorted[symbols->count].name = (const char*) strtab + name_off;
+        sorted[symbols->count].type = symbolType(info, shndx, sections, shnum);
+        sorted[symbols->count].index = i;
+        symbols->count++;
+    }
+
+    // sort on the full names, like nm, before they are cut to fit
+    qsort(sorted, symbols->count, sizeof(sortRecord), compareRecords);
+
+    count = symbols->count;
+    symbols->count = 0;
+    for (i = 0; i < count; i++)
+        appendRecord(symbols, &capacity, sorted[i].type, sorted[i].name);
+
+    free(sorted);
+    free(sections);
+    return true;
+}
+
+/*
+ * function:    symbolType
+ * description: pick the letter nm shows for an ELF symbol
+ * params:
+ *      info            the symbol's st_info
+ *      shndx           the symbol's section index
+ *      sections        the file's sections
+ *      section_count   the number of sections
+ * returns:     the type letter
+ */
+char symbolType(unsigned char info, uint16_t shndx,
+    sectionInfo *sections, uint32_t section_count)
+{
+    unsigned char bind = ELF64_ST_BIND(info);
+    unsigned char type = ELF64_ST_TYPE(info);
+    sectionInfo *sec;
+    char c;
+
+    if (shndx == SHN_COMMON)
+        return 'C';
+    if (shndx == SHN_UNDEF)
+    {
+        if (bind == STB_WEAK)
+            return type == STT_OBJECT ? 'v' : 'w';
+        return 'U';
+    }
+    if (type == STT_GNU_IFUNC)
+        return 'i';
+    if (bind == STB_WEAK)
+        return type == STT_OBJECT ? 'V' : 'W';
+    if (bind == STB_GNU_UNIQUE)
+        return 'u';
+    if (bind != STB_GLOBAL && bind != STB_LOCAL)
+        return '?';
+
+    if (shndx == SHN_ABS)
+        c = 'a';
+    else if (shndx >= SHN_LORESERVE || shndx >= section_count)
+        c = '?';
+    else
+    {
+        sec = &sections[shndx];
+        if (sec->flags & SHF_EXECINSTR)
+            c = 't';
+        else if ((sec->flags & SHF_ALLOC) && sec->type != SHT_NOBITS)
+            c = (sec->flags & SHF_WRITE) ? 'd' : 'r';
+        else if (sec->type == SHT_NOBITS)
+            c = 'b';
+        else if (!(sec->flags & SHF_WRITE))
+            c = 'n';
+        else
+            c = '?';
+    }
+
+    return bind == STB_GLOBAL ? toupper(c) : c;
+}
+
+/*
+ * function:    compareRecords
+ * description: qsort comparison of records by name, then by symbol index
+ */
+int compareRecords(const void *a, const void *b)
+{
+    const sortRecord *x = (const sortRecord*) a;
+    const sortRecord *y = (const sortRecord*) b;
+    int c = strcmp(x->name, y->name);
+
+    if (c != 0)
+        return c;
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+/*
+ * function:    compareNmFiles
+ * description: qsort comparison of files by name, then place in the batch
+ */
+int compareNmFiles(const void *a, const void *b)
+{
+    const nmFile *x = (const nmFile*) a;
+    const nmFile *y = (const nmFile*) b;
+    int c = strcmp(x->name, y->name);
+
+    if (c != 0)
+        return c;
+    return x->index - y->index;
+}
+
+/*
+ * function:    appendRecord
+ * description: add a record to the end of a file's symbols
+ * params:
+ *      symbols     the file's symbols
+ *      capacity    the number of records allocated so far
+ *      type        the symbol's type
+ *      name        the symbol's name
+ * returns:     true
+ */
+bool appendRecord(fileSymbols *symbols, int *capacity, char type,
+    const char *name)
+{
+    if (symbols->count == *capacity)
+    {
+        *capacity = *capacity == 0 ? 16 : *capacity * 2;
+        symbols->records = (symbolRecord*) realloc(symbols->records,
+            *capacity * sizeof(symbolRecord));
+        if (symbols->records == 0)
+        {
+            perror("in symbolSource - malloc unable to allocate space");
+            exit(0);
+        }
+    }
+
+    symbols->records[symbols->count].type = type;
+    strncpy(symbols->records[symbols->count].name, name, 30);
+    symbols->records[symbols->count].name[30] = '\0';
+    symbols->records[symbols->count].symbol = 0;
+    symbols->count++;
+    return true;
+}
+
+/*
+ * function:    quoteArgument
+ * description: append a single quoted shell argument to a command
+ * params:
+ *      arg     the argument
+ *      out     where to write, must have room for 4 * strlen(arg) + 3
+ * returns:     the new end of the command
+ */
+char *quoteArgument(char *arg, char *out)
+{
+    *out++ = ' ';
+    *out++ = '\'';
+    for (; *arg != '\0'; arg++)
+    {
+        if (*arg == '\'')
+        {
+            memcpy(out, "'\\''", 4);
+            out += 4;
+        }
+        else
+            *out++ = *arg;
+    }
+    *out++ = '\'';
+    *out = '\0';
+    return out;
+}
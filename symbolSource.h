@@ -0,0 +1,127 @@
+#ifndef SYMBOLSOURCE_H
+#define SYMBOLSOURCE_H
+
+#include <stdint.h>
+#include "bool.h"
+
+struct symbolName;
+
+/*
+ * a symbol as nm would print it, names longer than 30 characters are
+ * truncated to fit the symbol lists.  symbol is the name once a
+ * symbolTable has interned it, 0 until then
+ */
+typedef struct symbolRecord
+{
+    char type;
+    char name[31];
+    struct symbolName *symbol;
+} symbolRecord;
+
+/*
+ * the symbols of one object file in nm order, sorted by name
+ */
+typedef struct fileSymbols
+{
+    symbolRecord *records;
+    int count;
+} fileSymbols;
+
+/*
+ * a backend that reads the symbols of object files
+ */
+typedef struct symbolSource
+{
+    // name used to pick the backend on the command line
+    char *name;
+
+    /*
+     * read the symbols of count files into symbols[0..count-1], returns
+     * false if the backend failed outright, a file that cannot be read
+     * just gets no symbols
+     */
+    bool (*read)(char **files, int count, fileSymbols *symbols);
+} symbolSource;
+
+/*
+ * reads ELF object files in process and hands anything else to nmSource
+ */
+extern symbolSource nativeSource;
+
+/*
+ * runs nm -A once per batch of files and splits the output by file name
+ */
+extern symbolSource nmSource;
+
+/*
+ * function:    findSymbolSource
+ * description: look up a backend by name
+ * params:
+ *      name    the backend's name, "native" or "nm"
+ * returns:     the backend, or 0 if there is no backend with that name
+ */
+symbolSource *findSymbolSource(char *name);
+
+/*
+ * function:    readFileSymbols
+ * description: read the symbols of a list of files, at most batch files
+ *              are handed to the backend at a time.  Files are hashed
+ *              first and a file whose content was read before reuses the
+ *              records parsed then, the records belong to that cache and
+ *              live until freeSymbolCache is called
+ * params:
+ *      source  the backend to read with
+ *      files   the files to read
+ *      count   the number of files
+ *      batch   the most files to pass to one backend call
+ *      symbols array of count fileSymbols to fill in
+ * returns:     true on success, false otherwise
+ */
+bool readFileSymbols(symbolSource *source, char **files, int count,
+    int batch, fileSymbols *symbols);
+
+/*
+ * function:    readElfMember
+ * description: parse an ELF member of an archive in place, only the parts
+ *              that hold the symbols are read
+ * params:
+ *      fd          the open archive
+ *      offset      where the member starts
+ *      size        the member's size
+ *      budget      the most bytes that may be read into memory at once
+ *      symbols     gets the member's symbols
+ * returns:     true if the member was ELF and fit the budget, false if
+ *              another backend should read it
+ */
+bool readElfMember(int fd, uint64_t offset, uint64_t size, uint64_t budget,
+    fileSymbols *symbols);
+
+/*
+ * function:    freeFileSymbols
+ * description: let go of the records read for a file, they stay in the
+ *              content cache for the next file with the same content
+ * params:
+ *      symbols the file's symbols
+ * returns:     void
+ */
+void freeFileSymbols(fileSymbols *symbols);
+
+/*
+ * function:    freeSymbolCache
+ * description: free the content cache and the records in it, records
+ *              readFileSymbols handed out before are gone after this
+ * returns:     void
+ */
+void freeSymbolCache();
+
+/*
+ * function:    symbolCacheStats
+ * description: report how well the content cache did
+ * params:
+ *      parsed  set to the number of files a backend had to read
+ *      reused  set to the number of files whose records were reused
+ * returns:     void
+ */
+void symbolCacheStats(int *parsed, int *reused);
+
+#endif
@@ -0,0 +1,179 @@
+#include "trace.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct traceEvent
+{
+    uint64_t ts;
+    const char *category;
+    char phase;
+    char name[TRACE_NAME_LEN];
+} traceEvent;
+
+static traceEvent *events = 0;
+static unsigned long event_count = 0;
+static char *trace_file = 0;
+static struct timespec start;
+
+static void record(char phase, const char *category, const char *name);
+static void writeString(FILE *fp, const char *s);
+
+/*
+ * function:    traceOpen
+ * description: start recording events, they are written to filename in
+ *              trace event JSON when the program exits
+ * params:
+ *      filename    the path of the trace file to create
+ * returns:     true on success, false otherwise
+ */
+bool traceOpen(char *filename)
+{
+    if (events == 0)
+    {
+        events = (traceEvent*) malloc(TRACE_CAPACITY * sizeof(traceEvent));
+        if (events == 0)
+        {
+            perror("in trace - malloc unable to allocate space");
+            return false;
+        }
+        atexit(traceFlush);
+    }
+
+    trace_file = filename;
+    event_count = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    return true;
+}
+
+/*
+ * function:    traceBegin
+ * description: record the start of a span, does nothing unless traceOpen
+ *              was called
+ * params:
+ *      category    the span's category, must be a string literal
+ *      name        the span's name, copied and truncated to TRACE_NAME_LEN
+ * returns:     void
+ */
+void traceBegin(const char *category, const char *name)
+{
+    if (trace_file != 0)
+        record('B', category, name);
+}
+
+/*
+ * function:    traceEnd
+ * description: record the end of the span most recently begun
+ * params:
+ *      category    the span's category, must be a string literal
+ *      name        the span's name
+ * returns:     void
+ */
+void traceEnd(const char *category, const char *name)
+{
+    if (trace_file != 0)
+        record('E', category, name);
+}
+
+/*
+ * function:    traceFlush
+ * description: write the recorded events and stop recording, called
+ *              automatically at exit
+ * returns:     void
+ */
+void traceFlush()
+{
+    unsigned long first, i;
+    long depth = 0;
+    bool comma = false;
+    traceEvent *e;
+    FILE *fp;
+
+    if (trace_file == 0)
+        return;
+
+    fp = fopen(trace_file, "w");
+    trace_file = 0;
+    if (fp == NULL)
+    {
+        perror("in trace - unable to write trace");
+        return;
+    }
+
+    first = event_count > TRACE_CAPACITY ? event_count - TRACE_CAPACITY : 0;
+
+    fprintf(fp, "{\"traceEvents\":[\n");
+    for (i = first; i < event_count; i++)
+    {
+        e = &events[i % TRACE_CAPACITY];
+
+        // once the ring has wrapped, drop ends whose begins were overwritten
+        if (e->phase == 'B')
+            depth++;
+        else if (depth == 0)
+            continue;
+        else
+            depth--;
+
+        fprintf(fp, "%s{\"ph\":\"%c\",\"cat\":", comma ? ",\n" : "", e->phase);
+        writeString(fp, e->category);
+        fprintf(fp, ",\"name\":");
+        writeString(fp, e->name);
+        fprintf(fp, ",\"ts\":%llu.%03llu,\"pid\":1,\"tid\":1}",
+            (unsigned long long) (e->ts / 1000),
+            (unsigned long long) (e->ts % 1000));
+        comma = true;
+    }
+    fprintf(fp, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%lu}}\n",
+        first);
+
+    fclose(fp);
+}
+
+/*
+ * function:    record
+ * description: append an event to the ring
+ * params:
+ *      phase       'B' for begin, 'E' for end
+ *      category    the event's category
+ *      name        the event's name
+ * returns:     void
+ */
+void record(char phase, const char *category, const char *name)
+{
+    traceEvent *e = &events[event_count++ % TRACE_CAPACITY];
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    e->ts = (uint64_t) (now.tv_sec - start.tv_sec) * 1000000000ull +
+        now.tv_nsec - start.tv_nsec;
+    e->category = category;
+    e->phase = phase;
+    strncpy(e->name, name, TRACE_NAME_LEN - 1);
+    e->name[TRACE_NAME_LEN - 1] = '\0';
+}
+
+/*
+ * function:    writeString
+ * description: write a string as a JSON string literal
+ * params:
+ *      fp  the file to write to
+ *      s   the string
+ * returns:     void
+ */
+void writeString(FILE *fp, const char *s)
+{
+    fputc('"', fp);
+    for (; *s != '\0'; s++)
+    {
+        if (*s == '"' || *s == '\\')
+            fprintf(fp, "\\%c", *s);
+        else if ((unsigned char) *s < 0x20)
+            fprintf(fp, "\\u%04x", (unsigned char) *s);
+        else
+            fputc(*s, fp);
+    }
+    fputc('"', fp);
+}
@@ -0,0 +1,53 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "bool.h"
+
+/*
+ * Events are kept in a fixed size ring buffer and only written out when the
+ * program exits, so a trace costs a clock read and a copy per event.  When
+ * the ring fills up the oldest events are overwritten.
+ */
+#define TRACE_CAPACITY 65536
+#define TRACE_NAME_LEN 96
+
+/*
+ * function:    traceOpen
+ * description: start recording events, they are written to filename in
+ *              trace event JSON when the program exits
+ * params:
+ *      filename    the path of the trace file to create
+ * returns:     true on success, false otherwise
+ */
+bool traceOpen(char *filename);
+
+/*
+ * function:    traceBegin
+ * description: record the start of a span, does nothing unless traceOpen
+ *              was called
+ * params:
+ *      category    the span's category, must be a string literal
+ *      name        the span's name, copied and truncated to TRACE_NAME_LEN
+ * returns:     void
+ */
+void traceBegin(const char *category, const char *name);
+
+/*
+ * function:    traceEnd
+ * description: record the end of the span most recently begun
+ * params:
+ *      category    the span's category, must be a string literal
+ *      name        the span's name
+ * returns:     void
+ */
+void traceEnd(const char *category, const char *name);
+
+/*
+ * function:    traceFlush
+ * description: write the recorded events and stop recording, called
+ *              automatically at exit
+ * returns:     void
+ */
+void traceFlush();
+
+#endif